@@ -83,6 +83,16 @@ DK_DECL_OPAQUE(Image, 8, 128);
 DK_DECL_OPAQUE(ImageDescriptor, 4, 32);
 DK_DECL_OPAQUE(SamplerDescriptor, 4, 32);
 DK_DECL_HANDLE(Swapchain);
+DK_DECL_HANDLE(Defragmenter);
+DK_DECL_HANDLE(ShaderArena);
+DK_DECL_HANDLE(SparseImage);
+DK_DECL_HANDLE(ReadbackManager);
+DK_DECL_HANDLE(DescriptorPool);
+DK_DECL_HANDLE(BindlessTable);
+DK_DECL_HANDLE(ShaderCodeCache);
+DK_DECL_HANDLE(ShaderArchive);
+DK_DECL_HANDLE(Pipeline);
+DK_DECL_HANDLE(ShaderLoader);
 
 #undef DK_DECL_HANDLE
 #undef DK_DECL_OPAQUE
@@ -110,6 +120,7 @@ typedef void (*DkDebugFunc)(void* userData, const char* context, DkResult result
 typedef DkResult (*DkAllocFunc)(void* userData, size_t alignment, size_t size, void** out);
 typedef void (*DkFreeFunc)(void* userData, void* mem);
 typedef void (*DkCmdBufAddMemFunc)(void* userData, DkCmdBuf cmdbuf, size_t minReqSize);
+typedef void (*DkMemoryBudgetFunc)(void* userData, DkDevice device, uint64_t totalSize, uint64_t budget);
 
 enum
 {
@@ -119,6 +130,8 @@ enum
 	DkDeviceFlags_OriginLowerLeft    = 1U << 9,
 	DkDeviceFlags_YAxisPointsUp      = 0U << 10,
 	DkDeviceFlags_YAxisPointsDown    = 1U << 10,
+	DkDeviceFlags_CacheImageLayouts  = 1U << 11,
+	DkDeviceFlags_CacheSamplers      = 1U << 12,
 };
 
 typedef struct DkDeviceMaker
@@ -139,6 +152,38 @@ DK_CONSTEXPR void dkDeviceMakerDefaults(DkDeviceMaker* maker)
 	maker->flags = DkDeviceFlags_DepthZeroToOne | DkDeviceFlags_OriginUpperLeft;
 }
 
+typedef struct DkSlabStats
+{
+	uint32_t numRegions;
+	uint32_t numPages;
+	uint32_t numObjects;
+	uint32_t numFreeObjects;
+	uint64_t reservedSize;
+	uint64_t usedSize;
+} DkSlabStats;
+
+typedef struct DkProgramBindStats
+{
+	uint64_t numFastBinds; // program was already bound to the stage, only the stage was re-enabled
+	uint64_t numFullBinds; // stage had to be fully reprogrammed
+} DkProgramBindStats;
+
+typedef struct DkMemoryStats
+{
+	uint32_t numMemBlocks;
+	uint64_t totalSize;
+	uint64_t cpuUncachedSize;
+	uint64_t cpuCachedSize;
+	uint64_t gpuUncachedSize;
+	uint64_t gpuCachedSize;
+	uint64_t codeSize;
+	uint64_t imageSize;
+	uint64_t ownedSize;
+	uint64_t codeSegmentSize;
+	uint64_t queueCmdMemSize;
+	uint64_t queueWorkBufSize;
+} DkMemoryStats;
+
 #define DK_MEMBLOCK_ALIGNMENT 0x1000
 #define DK_CMDMEM_ALIGNMENT 4
 #define DK_QUEUE_MIN_CMDMEM_SIZE 0x10000
@@ -154,6 +199,9 @@ DK_CONSTEXPR void dkDeviceMakerDefaults(DkDeviceMaker* maker)
 #define DK_SHADER_CODE_UNUSABLE_SIZE 0x400
 #define DK_IMAGE_DESCRIPTOR_ALIGNMENT 0x20
 #define DK_SAMPLER_DESCRIPTOR_ALIGNMENT 0x20
+#define DK_DESCRIPTOR_INVALID UINT32_MAX
+#define DK_NUM_CACHED_SAMPLERS 4096
+#define DK_SHADER_MODULE_INVALID UINT32_MAX
 #define DK_MAX_RENDER_TARGETS 8
 #define DK_NUM_VIEWPORTS 16
 #define DK_NUM_SCISSORS 16
@@ -192,6 +240,13 @@ typedef struct DkMemBlockMaker
 	void* storage;
 } DkMemBlockMaker;
 
+typedef struct DkMemRange
+{
+	DkMemBlock memBlock;
+	uint32_t offset;
+	uint32_t size;
+} DkMemRange;
+
 DK_CONSTEXPR void dkMemBlockMakerDefaults(DkMemBlockMaker* maker, DkDevice device, uint32_t size)
 {
 	maker->device = device;
@@ -308,6 +363,45 @@ DK_CONSTEXPR void dkShaderMakerDefaults(DkShaderMaker* maker, DkMemBlock codeMem
 	maker->programId = 0;
 }
 
+typedef struct DkShaderModuleMaker
+{
+	DkMemBlock codeMem;
+	const void* source; // DKSH in memory (NULL: use fd, or if that is negative, the DKSH already at codeOffset)
+	uint32_t sourceSize;
+	int fd;
+	uint32_t codeOffset;
+} DkShaderModuleMaker;
+
+DK_CONSTEXPR void dkShaderModuleMakerDefaults(DkShaderModuleMaker* maker, DkMemBlock codeMem, uint32_t codeOffset)
+{
+	maker->codeMem = codeMem;
+	maker->source = NULL;
+	maker->sourceSize = 0;
+	maker->fd = -1;
+	maker->codeOffset = codeOffset;
+}
+
+typedef struct DkShaderCode
+{
+	DkMemBlock codeMem;
+	uint32_t codeOffset;
+	uint32_t size;
+} DkShaderCode;
+
+typedef void (*DkShaderArenaRelocFunc)(void* userData, void* codeUserData, DkShaderCode const* newCode);
+
+typedef struct DkShaderArenaMaker
+{
+	DkDevice device;
+	uint32_t blockSize;
+} DkShaderArenaMaker;
+
+DK_CONSTEXPR void dkShaderArenaMakerDefaults(DkShaderArenaMaker* maker, DkDevice device)
+{
+	maker->device = device;
+	maker->blockSize = 0x40000; // 256 KiB
+}
+
 typedef enum DkStage
 {
 	DkStage_Vertex   = 0,
@@ -379,6 +473,7 @@ enum
 	DkImageFlags_UsagePresent   = 1U << 10, // Specifies that the image will be used with a DkSwapchain.
 	DkImageFlags_Usage2DEngine  = 1U << 11, // Specifies that the image will be used with the 2D Engine (e.g. for transfers between images)
 	DkImageFlags_UsageVideo     = 1U << 12, // Specifies that the image will be used with hardware video encoding/decoding engines
+	DkImageFlags_UsageSparse    = 1U << 13, // Specifies that the image will be used with a DkSparseImage (tiles are laid out to match its pages)
 
 	// Informational flags only (for dkImageFormatGetFlags)
 	DkImageFormatFlags_IsInt    = 1U << 16, // Specifies that the image format is pure integer
@@ -1209,6 +1304,15 @@ typedef struct DkCopyBuf
 	uint32_t imageHeight;
 } DkCopyBuf;
 
+typedef struct DkCopyBufRegion
+{
+	uint64_t offset;
+	uint32_t rowLength;
+	uint32_t imageHeight;
+	uint32_t mipLevel;
+	DkImageRect rect;
+} DkCopyBufRegion;
+
 typedef struct DkSwapchainMaker
 {
 	DkDevice device;
@@ -1225,6 +1329,228 @@ DK_CONSTEXPR void dkSwapchainMakerDefaults(DkSwapchainMaker* maker, DkDevice dev
 	maker->numImages = numImages;
 }
 
+typedef struct DkDefragmenterMaker
+{
+	DkDevice device;
+	uint32_t maxBatchSize; // in bytes, batches are also limited to 256 copies
+	uint32_t copyRate;
+} DkDefragmenterMaker;
+
+DK_CONSTEXPR void dkDefragmenterMakerDefaults(DkDefragmenterMaker* maker, DkDevice device)
+{
+	maker->device = device;
+	maker->maxBatchSize = 0x400000; // 4 MiB
+	maker->copyRate = 4096; // bytes per microsecond
+}
+
+typedef struct DkDefragAlloc
+{
+	DkMemBlock memBlock;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t alignment;
+} DkDefragAlloc;
+
+typedef struct DkDefragRelocation
+{
+	uint32_t allocId;
+	DkMemBlock memBlock;
+	uint32_t oldOffset;
+	uint32_t newOffset;
+	uint32_t size;
+} DkDefragRelocation;
+
+typedef struct DkSparseImageMaker
+{
+	DkDevice device;
+	DkImageLayout const* layout;
+} DkSparseImageMaker;
+
+DK_CONSTEXPR void dkSparseImageMakerDefaults(DkSparseImageMaker* maker, DkDevice device, DkImageLayout const* layout)
+{
+	maker->device = device;
+	maker->layout = layout;
+}
+
+typedef struct DkReadbackManagerMaker
+{
+	DkDevice device;
+	uint32_t stagingSize;
+	uint32_t maxReadbacks;
+} DkReadbackManagerMaker;
+
+DK_CONSTEXPR void dkReadbackManagerMakerDefaults(DkReadbackManagerMaker* maker, DkDevice device)
+{
+	maker->device = device;
+	maker->stagingSize = 0x400000; // 4 MiB
+	maker->maxReadbacks = 64;
+}
+
+// A readback can only be released once the command list that records it has been
+// submitted (releasing it earlier is an error, and is ignored in release builds)
+typedef struct DkReadback
+{
+	uint32_t slot;
+	uint32_t serial;
+} DkReadback;
+
+// Released descriptors are only reused after a later dkDescriptorPoolCommit has been
+// submitted and executed, so that work still in flight never sees them rewritten.
+typedef struct DkDescriptorPoolMaker
+{
+	DkDevice device;
+	uint32_t numDescriptors;
+} DkDescriptorPoolMaker;
+
+DK_CONSTEXPR void dkDescriptorPoolMakerDefaults(DkDescriptorPoolMaker* maker, DkDevice device, uint32_t numDescriptors)
+{
+	maker->device = device;
+	maker->numDescriptors = numDescriptors;
+}
+
+typedef struct DkBindlessTableMaker
+{
+	DkDevice device;
+	uint32_t numDescriptors;
+} DkBindlessTableMaker;
+
+DK_CONSTEXPR void dkBindlessTableMakerDefaults(DkBindlessTableMaker* maker, DkDevice device, uint32_t numDescriptors)
+{
+	maker->device = device;
+	maker->numDescriptors = numDescriptors;
+}
+
+typedef struct DkShaderCodeCacheMaker
+{
+	DkDevice device;
+	uint32_t maxEntries;
+	uint32_t blockSize;
+} DkShaderCodeCacheMaker;
+
+DK_CONSTEXPR void dkShaderCodeCacheMakerDefaults(DkShaderCodeCacheMaker* maker, DkDevice device)
+{
+	maker->device = device;
+	maker->maxEntries = 1024;
+	maker->blockSize = 0x40000; // 256 KiB
+}
+
+typedef struct DkShaderArchiveMaker
+{
+	DkDevice device;
+	const void* data; // archive in memory (NULL: read from fd on demand)
+	uint32_t dataSize;
+	int fd;
+	uint32_t blockSize;
+} DkShaderArchiveMaker;
+
+DK_CONSTEXPR void dkShaderArchiveMakerDefaults(DkShaderArchiveMaker* maker, DkDevice device)
+{
+	maker->device = device;
+	maker->data = NULL;
+	maker->dataSize = 0;
+	maker->fd = -1;
+	maker->blockSize = 0x40000; // 256 KiB
+}
+
+typedef struct DkPipelineMaker
+{
+	DkDevice device;
+	uint32_t stageMask; // graphics stages only
+	DkShader const* const* shaders;
+	uint32_t numShaders;
+	// Optional state groups (NULL: left untouched when the pipeline is bound)
+	DkRasterizerState const* rasterizerState;
+	DkMultisampleState const* multisampleState;
+	DkColorState const* colorState;
+	DkColorWriteState const* colorWriteState;
+	DkBlendState const* blendStates;
+	uint32_t numBlendStates;
+	DkDepthStencilState const* depthStencilState;
+	// Vertex input state is always part of the pipeline
+	DkVtxAttribState const* vtxAttribs;
+	uint32_t numVtxAttribs;
+	DkVtxBufferState const* vtxBuffers;
+	uint32_t numVtxBuffers;
+} DkPipelineMaker;
+
+DK_CONSTEXPR void dkPipelineMakerDefaults(DkPipelineMaker* maker, DkDevice device)
+{
+	maker->device = device;
+	maker->stageMask = DkStageFlag_GraphicsMask;
+	maker->shaders = NULL;
+	maker->numShaders = 0;
+	maker->rasterizerState = NULL;
+	maker->multisampleState = NULL;
+	maker->colorState = NULL;
+	maker->colorWriteState = NULL;
+	maker->blendStates = NULL;
+	maker->numBlendStates = 0;
+	maker->depthStencilState = NULL;
+	maker->vtxAttribs = NULL;
+	maker->numVtxAttribs = 0;
+	maker->vtxBuffers = NULL;
+	maker->numVtxBuffers = 0;
+}
+
+typedef struct DkShaderLoadJob
+{
+	const void* source; // DKSH in memory (NULL: read from fd)
+	uint32_t sourceSize;
+	int fd;
+	DkShader* shaders;
+	uint32_t maxShaders;
+	void* userData; // stored in the shader arena alongside the code
+	// Filled in by the loader
+	DkResult result;
+	uint32_t numShaders;
+	DkShaderCode code;
+	bool done;
+	bool submitted;
+} DkShaderLoadJob;
+
+DK_CONSTEXPR void dkShaderLoadJobDefaults(DkShaderLoadJob* job, DkShader shaders[], uint32_t maxShaders)
+{
+	job->source = NULL;
+	job->sourceSize = 0;
+	job->fd = -1;
+	job->shaders = shaders;
+	job->maxShaders = maxShaders;
+	job->userData = NULL;
+	job->result = DkResult_Success;
+	job->numShaders = 0;
+	job->code.codeMem = NULL;
+	job->code.codeOffset = 0;
+	job->code.size = 0;
+	job->done = false;
+	job->submitted = false;
+}
+
+typedef void (*DkShaderLoadDoneFunc)(void* userData, DkShaderLoadJob* job);
+
+typedef struct DkShaderLoaderMaker
+{
+	DkDevice device;
+	DkShaderArena arena;
+	void* userData;
+	DkShaderLoadDoneFunc cbDone; // called from a worker thread with a copy of each completed job
+	uint32_t numThreads;
+	uint32_t maxQueuedJobs;
+	int threadPriority;
+	uint32_t threadCpuMask; // worker threads are spread over these cores
+} DkShaderLoaderMaker;
+
+DK_CONSTEXPR void dkShaderLoaderMakerDefaults(DkShaderLoaderMaker* maker, DkDevice device, DkShaderArena arena)
+{
+	maker->device = device;
+	maker->arena = arena;
+	maker->userData = NULL;
+	maker->cbDone = NULL;
+	maker->numThreads = 3;
+	maker->maxQueuedJobs = 256;
+	maker->threadPriority = 0x2C;
+	maker->threadCpuMask = 0x7;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -1233,6 +1559,13 @@ DkDevice dkDeviceCreate(DkDeviceMaker const* maker);
 void dkDeviceDestroy(DkDevice obj);
 uint64_t dkDeviceGetCurrentTimestamp(DkDevice obj);
 uint64_t dkDeviceGetCurrentTimestampInNs(DkDevice obj);
+void dkDeviceGetSlabStats(DkDevice obj, DkSlabStats* out);
+void dkDeviceGetMemoryStats(DkDevice obj, DkMemoryStats* out);
+void dkDeviceSetMemoryBudget(DkDevice obj, uint64_t budget, DkMemoryBudgetFunc func, void* userData);
+DkGpuAddr dkDeviceGetSamplerCacheGpuAddr(DkDevice obj);
+uint32_t dkDeviceAcquireSampler(DkDevice obj, DkSampler const* sampler);
+void dkDeviceReleaseSampler(DkDevice obj, uint32_t id);
+void dkDeviceCommitSamplers(DkDevice obj, DkCmdBuf cmdbuf);
 DK_CONSTEXPR uint64_t dkTimestampToNs(uint64_t ts);
 DK_CONSTEXPR uint64_t dkNsToTimestamp(uint64_t ns);
 
@@ -1242,6 +1575,9 @@ void* dkMemBlockGetCpuAddr(DkMemBlock obj);
 DkGpuAddr dkMemBlockGetGpuAddr(DkMemBlock obj);
 uint32_t dkMemBlockGetSize(DkMemBlock obj);
 DkResult dkMemBlockFlushCpuCache(DkMemBlock obj, uint32_t offset, uint32_t size);
+void dkMemBlockMarkDirty(DkMemBlock obj, uint32_t offset, uint32_t size);
+DkResult dkMemBlockFlushDirty(DkMemBlock obj);
+DkResult dkMemBlockFlushCpuCacheRanges(DkMemRange const ranges[], uint32_t numRanges);
 
 DkResult dkFenceWait(DkFence* obj, int64_t timeout_ns);
 void dkFenceImport(DkFence* obj, uint32_t id, uint32_t value);
@@ -1255,6 +1591,7 @@ void dkCmdBufDestroy(DkCmdBuf obj);
 void dkCmdBufAddMemory(DkCmdBuf obj, DkMemBlock mem, uint32_t offset, uint32_t size);
 DkCmdList dkCmdBufFinishList(DkCmdBuf obj);
 void dkCmdBufClear(DkCmdBuf obj);
+void dkCmdBufGetProgramBindStats(DkCmdBuf obj, DkProgramBindStats* out);
 void dkCmdBufBeginCaptureCmds(DkCmdBuf obj, uint32_t* storage, uint32_t max_words);
 uint32_t dkCmdBufEndCaptureCmds(DkCmdBuf obj);
 void dkCmdBufReplayCmds(DkCmdBuf obj, const uint32_t* words, uint32_t num_words);
@@ -1280,6 +1617,7 @@ void dkCmdBufBindBlendStates(DkCmdBuf obj, uint32_t firstId, DkBlendState const
 void dkCmdBufBindDepthStencilState(DkCmdBuf obj, DkDepthStencilState const* state);
 void dkCmdBufBindVtxAttribState(DkCmdBuf obj, DkVtxAttribState const attribs[], uint32_t numAttribs);
 void dkCmdBufBindVtxBufferState(DkCmdBuf obj, DkVtxBufferState const buffers[], uint32_t numBuffers);
+void dkCmdBufBindPipeline(DkCmdBuf obj, DkPipeline pipeline, DkPipeline prev);
 void dkCmdBufBindVtxBuffers(DkCmdBuf obj, uint32_t firstId, DkBufExtents const buffers[], uint32_t numBuffers);
 void dkCmdBufBindIdxBuffer(DkCmdBuf obj, DkIdxFormat format, DkGpuAddr address);
 void dkCmdBufSetViewports(DkCmdBuf obj, uint32_t firstId, DkViewport const viewports[], uint32_t numViewports);
@@ -1319,10 +1657,14 @@ void dkCmdBufDispatchComputeIndirect(DkCmdBuf obj, DkGpuAddr indirect);
 void dkCmdBufPushConstants(DkCmdBuf obj, DkGpuAddr uboAddr, uint32_t uboSize, uint32_t offset, uint32_t size, const void* data);
 void dkCmdBufPushData(DkCmdBuf obj, DkGpuAddr addr, const void* data, uint32_t size);
 void dkCmdBufCopyBuffer(DkCmdBuf obj, DkGpuAddr srcAddr, DkGpuAddr dstAddr, uint32_t size);
+void dkCmdBufFillBuffer(DkCmdBuf obj, DkGpuAddr addr, uint32_t size, uint32_t value);
+void dkCmdBufFillImage(DkCmdBuf obj, DkImageView const* dstView, DkImageRect const* dstRect, const void* value);
 void dkCmdBufCopyImage(DkCmdBuf obj, DkImageView const* srcView, DkImageRect const* srcRect, DkImageView const* dstView, DkImageRect const* dstRect, uint32_t flags);
 void dkCmdBufBlitImage(DkCmdBuf obj, DkImageView const* srcView, DkImageRect const* srcRect, DkImageView const* dstView, DkImageRect const* dstRect, uint32_t flags, uint32_t factor);
 void dkCmdBufResolveImage(DkCmdBuf obj, DkImageView const* srcView, DkImageView const* dstView);
+void dkCmdBufGenerateMipmaps(DkCmdBuf obj, DkImage const* image, uint32_t baseLevel, uint32_t levelCount, uint32_t flags);
 void dkCmdBufCopyBufferToImage(DkCmdBuf obj, DkCopyBuf const* src, DkImageView const* dstView, DkImageRect const* dstRect, uint32_t flags);
+void dkCmdBufCopyBufferToImageMips(DkCmdBuf obj, DkGpuAddr src, DkImage const* dstImage, DkCopyBufRegion const regions[], uint32_t numRegions);
 void dkCmdBufCopyImageToBuffer(DkCmdBuf obj, DkImageView const* srcView, DkImageRect const* srcRect, DkCopyBuf const* dst, uint32_t flags);
 void dkCmdBufReportCounter(DkCmdBuf obj, DkCounter type, DkGpuAddr addr);
 void dkCmdBufReportValue(DkCmdBuf obj, uint32_t value, DkGpuAddr addr);
@@ -1342,19 +1684,33 @@ void dkQueuePresentImage(DkQueue obj, DkSwapchain swapchain, int imageSlot);
 void dkShaderInitialize(DkShader* obj, DkShaderMaker const* maker);
 bool dkShaderIsValid(DkShader const* obj);
 DkStage dkShaderGetStage(DkShader const* obj);
+DkResult dkShaderModuleLoad(DkShaderModuleMaker const* maker, DkShader shaders[], uint32_t maxShaders, uint32_t* numShaders);
+
+DkShaderArena dkShaderArenaCreate(DkShaderArenaMaker const* maker);
+void dkShaderArenaDestroy(DkShaderArena obj);
+DkResult dkShaderArenaAlloc(DkShaderArena obj, uint32_t size, void* userData, DkShaderCode* out);
+DkResult dkShaderArenaLoad(DkShaderArena obj, const void* dksh, uint32_t dkshSize, void* userData, DkShaderCode* out);
+void dkShaderArenaFree(DkShaderArena obj, DkShaderCode const* code);
+uint32_t dkShaderArenaCompact(DkShaderArena obj, DkShaderArenaRelocFunc func, void* userData);
 
 uint32_t dkImageFormatGetFlags(DkImageFormat format);
 
 void dkImageLayoutInitialize(DkImageLayout* obj, DkImageLayoutMaker const* maker);
 uint64_t dkImageLayoutGetSize(DkImageLayout const* obj);
 uint32_t dkImageLayoutGetAlignment(DkImageLayout const* obj);
+uint64_t dkImageLayoutGetLevelOffset(DkImageLayout const* obj, uint32_t mipLevel);
+uint64_t dkImageLayoutGetLayerSize(DkImageLayout const* obj);
 
 void dkImageInitialize(DkImage* obj, DkImageLayout const* layout, DkMemBlock memBlock, uint32_t offset);
 DkGpuAddr dkImageGetGpuAddr(DkImage const* obj);
+void dkImageWriteTexels(DkImage const* obj, uint32_t mipLevel, DkImageRect const* rect, const void* src, uint32_t rowLength, uint32_t imageHeight);
+void dkImageReadTexels(DkImage const* obj, uint32_t mipLevel, DkImageRect const* rect, void* dst, uint32_t rowLength, uint32_t imageHeight);
 
 void dkImageDescriptorInitialize(DkImageDescriptor* obj, DkImageView const* view, bool usesLoadOrStore, bool decayMS);
+void dkImageDescriptorInitializeBatch(DkImageDescriptor objs[], DkImageView const views[], uint32_t numViews, bool usesLoadOrStore, bool decayMS);
 
 void dkSamplerDescriptorInitialize(DkSamplerDescriptor* obj, DkSampler const* sampler);
+void dkSamplerDescriptorInitializeBatch(DkSamplerDescriptor objs[], DkSampler const samplers[], uint32_t numSamplers);
 
 void dkMultisampleStateSetLocations(DkMultisampleState* obj, DkSampleLocation const* locations, uint32_t numLocations);
 
@@ -1364,6 +1720,67 @@ void dkSwapchainAcquireImage(DkSwapchain obj, int* imageSlot, DkFence* fence);
 void dkSwapchainSetCrop(DkSwapchain obj, int32_t left, int32_t top, int32_t right, int32_t bottom);
 void dkSwapchainSetSwapInterval(DkSwapchain obj, uint32_t interval);
 
+DkDefragmenter dkDefragmenterCreate(DkDefragmenterMaker const* maker);
+void dkDefragmenterDestroy(DkDefragmenter obj);
+uint32_t dkDefragmenterPlan(DkDefragmenter obj, DkDefragAlloc const allocs[], uint32_t numAllocs);
+uint32_t dkDefragmenterRecordBatch(DkDefragmenter obj, DkCmdBuf cmdbuf, uint64_t timeBudgetNs);
+bool dkDefragmenterIsDone(DkDefragmenter obj);
+DkDefragRelocation const* dkDefragmenterGetRelocations(DkDefragmenter obj, uint32_t* numRelocations);
+
+DkSparseImage dkSparseImageCreate(DkSparseImageMaker const* maker);
+void dkSparseImageDestroy(DkSparseImage obj);
+uint32_t dkSparseImageGetPageSize(DkSparseImage obj);
+void dkSparseImageInitImage(DkSparseImage obj, DkImage* out);
+DkResult dkSparseImageCommit(DkSparseImage obj, uint64_t offset, uint64_t size, DkMemBlock memBlock, uint32_t memOffset);
+void dkSparseImageDecommit(DkSparseImage obj, uint64_t offset, uint64_t size);
+
+DkReadbackManager dkReadbackManagerCreate(DkReadbackManagerMaker const* maker);
+void dkReadbackManagerDestroy(DkReadbackManager obj);
+DkResult dkReadbackManagerReadBuffer(DkReadbackManager obj, DkCmdBuf cmdbuf, DkGpuAddr srcAddr, uint32_t size, DkReadback* out);
+DkResult dkReadbackManagerReadImage(DkReadbackManager obj, DkCmdBuf cmdbuf, DkImageView const* srcView, DkImageRect const* srcRect, uint32_t flags, DkReadback* out);
+bool dkReadbackManagerIsReady(DkReadbackManager obj, DkReadback const* readback);
+DkResult dkReadbackManagerWait(DkReadbackManager obj, DkReadback const* readback, int64_t timeout_ns);
+const void* dkReadbackManagerGetData(DkReadbackManager obj, DkReadback const* readback, uint32_t* size);
+void dkReadbackManagerRelease(DkReadbackManager obj, DkReadback const* readback);
+
+DkDescriptorPool dkDescriptorPoolCreate(DkDescriptorPoolMaker const* maker);
+void dkDescriptorPoolDestroy(DkDescriptorPool obj);
+DkGpuAddr dkDescriptorPoolGetGpuAddr(DkDescriptorPool obj);
+uint32_t dkDescriptorPoolGetNumDescriptors(DkDescriptorPool obj);
+uint32_t dkDescriptorPoolAllocImage(DkDescriptorPool obj, DkImageDescriptor const* desc);
+uint32_t dkDescriptorPoolAllocSampler(DkDescriptorPool obj, DkSamplerDescriptor const* desc);
+void dkDescriptorPoolRelease(DkDescriptorPool obj, uint32_t id);
+void dkDescriptorPoolCommit(DkDescriptorPool obj, DkCmdBuf cmdbuf);
+
+DkBindlessTable dkBindlessTableCreate(DkBindlessTableMaker const* maker);
+void dkBindlessTableDestroy(DkBindlessTable obj);
+DkGpuAddr dkBindlessTableGetGpuAddr(DkBindlessTable obj);
+uint32_t dkBindlessTableGetNumDescriptors(DkBindlessTable obj);
+void dkBindlessTableSetImages(DkBindlessTable obj, uint32_t first, DkImageDescriptor const descs[], uint32_t count);
+void dkBindlessTableFlush(DkBindlessTable obj, DkCmdBuf cmdbuf);
+
+DkShaderCodeCache dkShaderCodeCacheCreate(DkShaderCodeCacheMaker const* maker);
+void dkShaderCodeCacheDestroy(DkShaderCodeCache obj);
+uint32_t dkShaderCodeCacheGetNumEntries(DkShaderCodeCache obj);
+DkResult dkShaderCodeCacheLoad(DkShaderCodeCache obj, const void* dksh, uint32_t dkshSize, DkShader shaders[], uint32_t maxShaders, uint32_t* numShaders);
+void dkShaderCodeCacheRelease(DkShaderCodeCache obj, DkShader const shaders[], uint32_t numShaders);
+
+DkShaderArchive dkShaderArchiveCreate(DkShaderArchiveMaker const* maker);
+void dkShaderArchiveDestroy(DkShaderArchive obj);
+uint32_t dkShaderArchiveGetNumModules(DkShaderArchive obj);
+uint32_t dkShaderArchiveFindModule(DkShaderArchive obj, const char* name);
+DkResult dkShaderArchiveGetShader(DkShaderArchive obj, uint32_t moduleId, uint32_t programId, DkShader const** out);
+
+DkPipeline dkPipelineCreate(DkPipelineMaker const* maker);
+void dkPipelineDestroy(DkPipeline obj);
+uint32_t dkPipelineGetNumWords(DkPipeline obj);
+
+DkShaderLoader dkShaderLoaderCreate(DkShaderLoaderMaker const* maker);
+void dkShaderLoaderDestroy(DkShaderLoader obj);
+void dkShaderLoaderSubmit(DkShaderLoader obj, DkShaderLoadJob* const jobs[], uint32_t numJobs);
+void dkShaderLoaderWait(DkShaderLoader obj, DkShaderLoadJob const* job);
+void dkShaderLoaderFinish(DkShaderLoader obj, DkCmdBuf cmdbuf);
+
 DK_CONSTEXPR uint64_t dkTimestampToNs(uint64_t ts) {
 	return (ts * 625) / 384;
 }
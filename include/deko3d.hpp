@@ -151,6 +151,13 @@ namespace dk
 		DK_HANDLE_COMMON_MEMBERS(Device);
 		uint64_t getCurrentTimestamp();
 		uint64_t getCurrentTimestampInNs();
+		void getSlabStats(DkSlabStats& out);
+		void getMemoryStats(DkMemoryStats& out);
+		void setMemoryBudget(uint64_t budget, DkMemoryBudgetFunc func, void* userData = nullptr);
+		DkGpuAddr getSamplerCacheGpuAddr();
+		uint32_t acquireSampler(DkSampler const& sampler);
+		void releaseSampler(uint32_t id);
+		void commitSamplers(DkCmdBuf cmdbuf);
 	};
 
 	struct MemBlock : public detail::Handle<::DkMemBlock>
@@ -160,6 +167,9 @@ namespace dk
 		DkGpuAddr getGpuAddr();
 		uint32_t getSize();
 		DkResult flushCpuCache(uint32_t offset, uint32_t size);
+		void markDirty(uint32_t offset, uint32_t size);
+		DkResult flushDirty();
+		static DkResult flushCpuCacheRanges(detail::ArrayProxy<DkMemRange const> ranges);
 	};
 
 	struct Fence : public detail::Opaque<::DkFence>
@@ -183,6 +193,7 @@ namespace dk
 		void addMemory(DkMemBlock mem, uint32_t offset, uint32_t size);
 		DkCmdList finishList();
 		void clear();
+		void getProgramBindStats(DkProgramBindStats& out);
 		void beginCaptureCmds(uint32_t* storage, uint32_t max_words);
 		uint32_t endCaptureCmds();
 		void replayCmds(detail::ArrayProxy<uint32_t const> words);
@@ -210,6 +221,7 @@ namespace dk
 		void bindDepthStencilState(DkDepthStencilState const& state);
 		void bindVtxAttribState(detail::ArrayProxy<DkVtxAttribState const> attribs);
 		void bindVtxBufferState(detail::ArrayProxy<DkVtxBufferState const> buffers);
+		void bindPipeline(DkPipeline pipeline, DkPipeline prev = nullptr);
 		void bindVtxBuffer(uint32_t id, DkGpuAddr bufAddr, uint32_t bufSize);
 		void bindVtxBuffers(uint32_t firstId, detail::ArrayProxy<DkBufExtents const> buffers);
 		void bindIdxBuffer(DkIdxFormat format, DkGpuAddr address);
@@ -251,10 +263,14 @@ namespace dk
 		void pushConstants(DkGpuAddr uboAddr, uint32_t uboSize, uint32_t offset, uint32_t size, const void* data);
 		void pushData(DkGpuAddr addr, const void* data, uint32_t size);
 		void copyBuffer(DkGpuAddr srcAddr, DkGpuAddr dstAddr, uint32_t size);
+		void fillBuffer(DkGpuAddr addr, uint32_t size, uint32_t value = 0);
+		void fillImage(DkImageView const& dstView, DkImageRect const& dstRect, const void* value);
 		void copyImage(DkImageView const& srcView, DkImageRect const& srcRect, DkImageView const& dstView, DkImageRect const& dstRect, uint32_t flags = 0);
 		void blitImage(DkImageView const& srcView, DkImageRect const& srcRect, DkImageView const& dstView, DkImageRect const& dstRect, uint32_t flags = 0, uint32_t factor = 0);
 		void resolveImage(DkImageView const& srcView, DkImageView const& dstView);
+		void generateMipmaps(DkImage const& image, uint32_t baseLevel = 0, uint32_t levelCount = 0, uint32_t flags = DkBlitFlag_FilterLinear);
 		void copyBufferToImage(DkCopyBuf const& src, DkImageView const& dstView, DkImageRect const& dstRect, uint32_t flags = 0);
+		void copyBufferToImageMips(DkGpuAddr src, DkImage const& dstImage, detail::ArrayProxy<DkCopyBufRegion const> regions);
 		void copyImageToBuffer(DkImageView const& srcView, DkImageRect const& srcRect, DkCopyBuf const& dst, uint32_t flags = 0);
 		void reportCounter(DkCounter type, DkGpuAddr addr);
 		void reportValue(uint32_t value, DkGpuAddr addr);
@@ -286,6 +302,8 @@ namespace dk
 		DK_OPAQUE_COMMON_MEMBERS(ImageLayout);
 		uint64_t getSize() const;
 		uint32_t getAlignment() const;
+		uint64_t getLevelOffset(uint32_t mipLevel) const;
+		uint64_t getLayerSize() const;
 	};
 
 	struct Image : public detail::Opaque<::DkImage>
@@ -294,6 +312,8 @@ namespace dk
 		void initialize(ImageLayout const& layout, DkMemBlock memBlock, uint32_t offset);
 		DkGpuAddr getGpuAddr() const;
 		ImageLayout const& getLayout() const;
+		void writeTexels(uint32_t mipLevel, DkImageRect const& rect, const void* src, uint32_t rowLength = 0, uint32_t imageHeight = 0) const;
+		void readTexels(uint32_t mipLevel, DkImageRect const& rect, void* dst, uint32_t rowLength = 0, uint32_t imageHeight = 0) const;
 	};
 
 	struct Swapchain : public detail::Handle<::DkSwapchain>
@@ -304,6 +324,94 @@ namespace dk
 		void setSwapInterval(uint32_t interval);
 	};
 
+	struct ShaderArena : public detail::Handle<::DkShaderArena>
+	{
+		DK_HANDLE_COMMON_MEMBERS(ShaderArena);
+		DkResult alloc(uint32_t size, void* userData, DkShaderCode& out);
+		DkResult load(const void* dksh, uint32_t dkshSize, void* userData, DkShaderCode& out);
+		void free(DkShaderCode const& code);
+		uint32_t compact(DkShaderArenaRelocFunc func, void* userData = nullptr);
+	};
+
+	struct Defragmenter : public detail::Handle<::DkDefragmenter>
+	{
+		DK_HANDLE_COMMON_MEMBERS(Defragmenter);
+		uint32_t plan(detail::ArrayProxy<DkDefragAlloc const> allocs);
+		uint32_t recordBatch(DkCmdBuf cmdbuf, uint64_t timeBudgetNs);
+		bool isDone();
+		detail::ArrayProxy<DkDefragRelocation const> getRelocations();
+	};
+
+	struct SparseImage : public detail::Handle<::DkSparseImage>
+	{
+		DK_HANDLE_COMMON_MEMBERS(SparseImage);
+		uint32_t getPageSize();
+		void initImage(Image& out);
+		DkResult commit(uint64_t offset, uint64_t size, DkMemBlock memBlock, uint32_t memOffset);
+		void decommit(uint64_t offset, uint64_t size);
+	};
+
+	struct ReadbackManager : public detail::Handle<::DkReadbackManager>
+	{
+		DK_HANDLE_COMMON_MEMBERS(ReadbackManager);
+		DkResult readBuffer(DkCmdBuf cmdbuf, DkGpuAddr srcAddr, uint32_t size, DkReadback& out);
+		DkResult readImage(DkCmdBuf cmdbuf, DkImageView const& srcView, DkImageRect const& srcRect, DkReadback& out, uint32_t flags = 0);
+		bool isReady(DkReadback const& readback);
+		DkResult wait(DkReadback const& readback, int64_t timeout_ns = -1);
+		const void* getData(DkReadback const& readback, uint32_t* size = nullptr);
+		void release(DkReadback const& readback);
+	};
+
+	struct DescriptorPool : public detail::Handle<::DkDescriptorPool>
+	{
+		DK_HANDLE_COMMON_MEMBERS(DescriptorPool);
+		DkGpuAddr getGpuAddr();
+		uint32_t getNumDescriptors();
+		uint32_t allocImage(DkImageDescriptor const& desc);
+		uint32_t allocSampler(DkSamplerDescriptor const& desc);
+		void release(uint32_t id);
+		void commit(DkCmdBuf cmdbuf);
+	};
+
+	struct BindlessTable : public detail::Handle<::DkBindlessTable>
+	{
+		DK_HANDLE_COMMON_MEMBERS(BindlessTable);
+		DkGpuAddr getGpuAddr();
+		uint32_t getNumDescriptors();
+		void setImages(uint32_t first, detail::ArrayProxy<DkImageDescriptor const> descs);
+		void flush(DkCmdBuf cmdbuf);
+	};
+
+	struct ShaderCodeCache : public detail::Handle<::DkShaderCodeCache>
+	{
+		DK_HANDLE_COMMON_MEMBERS(ShaderCodeCache);
+		uint32_t getNumEntries();
+		DkResult load(const void* dksh, uint32_t dkshSize, detail::ArrayProxy<Shader> shaders, uint32_t* numShaders = nullptr);
+		void release(detail::ArrayProxy<Shader const> shaders);
+	};
+
+	struct ShaderArchive : public detail::Handle<::DkShaderArchive>
+	{
+		DK_HANDLE_COMMON_MEMBERS(ShaderArchive);
+		uint32_t getNumModules();
+		uint32_t findModule(const char* name);
+		DkResult getShader(uint32_t moduleId, uint32_t programId, DkShader const*& out);
+	};
+
+	struct Pipeline : public detail::Handle<::DkPipeline>
+	{
+		DK_HANDLE_COMMON_MEMBERS(Pipeline);
+		uint32_t getNumWords();
+	};
+
+	struct ShaderLoader : public detail::Handle<::DkShaderLoader>
+	{
+		DK_HANDLE_COMMON_MEMBERS(ShaderLoader);
+		void submit(detail::ArrayProxy<DkShaderLoadJob* const> jobs);
+		void wait(DkShaderLoadJob const& job);
+		void finish(DkCmdBuf cmdbuf = nullptr);
+	};
+
 	struct DeviceMaker : public ::DkDeviceMaker
 	{
 		DeviceMaker() noexcept : DkDeviceMaker{} { ::dkDeviceMakerDefaults(this); }
@@ -354,6 +462,21 @@ namespace dk
 		void initialize(Shader& obj) const;
 	};
 
+	struct ShaderModuleMaker : public ::DkShaderModuleMaker
+	{
+		ShaderModuleMaker(DkMemBlock codeMem, uint32_t codeOffset) noexcept : DkShaderModuleMaker{} { ::dkShaderModuleMakerDefaults(this, codeMem, codeOffset); }
+		ShaderModuleMaker& setSource(const void* source, uint32_t sourceSize) noexcept { this->source = source; this->sourceSize = sourceSize; return *this; }
+		ShaderModuleMaker& setFd(int fd) noexcept { this->fd = fd; return *this; }
+		DkResult load(detail::ArrayProxy<Shader> shaders, uint32_t* numShaders = nullptr) const;
+	};
+
+	struct ShaderArenaMaker : public ::DkShaderArenaMaker
+	{
+		ShaderArenaMaker(DkDevice device) noexcept : DkShaderArenaMaker{} { ::dkShaderArenaMakerDefaults(this, device); }
+		ShaderArenaMaker& setBlockSize(uint32_t blockSize) noexcept { this->blockSize = blockSize; return *this; }
+		ShaderArena create() const;
+	};
+
 	struct ImageLayoutMaker : public ::DkImageLayoutMaker
 	{
 		ImageLayoutMaker(DkDevice device) noexcept : DkImageLayoutMaker{} { ::dkImageLayoutMakerDefaults(this, device); }
@@ -406,6 +529,7 @@ namespace dk
 	{
 		DK_OPAQUE_COMMON_MEMBERS(ImageDescriptor);
 		void initialize(ImageView const& view, bool usesLoadOrStore = false, bool decayMS = false);
+		static void initializeBatch(ImageDescriptor* objs, detail::ArrayProxy<DkImageView const> views, bool usesLoadOrStore = false, bool decayMS = false);
 	};
 
 	struct Sampler : public ::DkSampler
@@ -471,6 +595,7 @@ namespace dk
 	{
 		DK_OPAQUE_COMMON_MEMBERS(SamplerDescriptor);
 		void initialize(Sampler const& sampler);
+		static void initializeBatch(SamplerDescriptor* objs, detail::ArrayProxy<DkSampler const> samplers);
 	};
 
 	struct RasterizerState : public ::DkRasterizerState
@@ -560,6 +685,108 @@ namespace dk
 		Swapchain create() const;
 	};
 
+	struct DefragmenterMaker : public ::DkDefragmenterMaker
+	{
+		DefragmenterMaker(DkDevice device) noexcept : DkDefragmenterMaker{} { ::dkDefragmenterMakerDefaults(this, device); }
+		DefragmenterMaker& setMaxBatchSize(uint32_t maxBatchSize) noexcept { this->maxBatchSize = maxBatchSize; return *this; }
+		DefragmenterMaker& setCopyRate(uint32_t copyRate) noexcept { this->copyRate = copyRate; return *this; }
+		Defragmenter create() const;
+	};
+
+	struct SparseImageMaker : public ::DkSparseImageMaker
+	{
+		SparseImageMaker(DkDevice device, ImageLayout const& layout) noexcept : DkSparseImageMaker{} { ::dkSparseImageMakerDefaults(this, device, &layout); }
+		SparseImageMaker& setLayout(ImageLayout const& layout) noexcept { this->layout = &layout; return *this; }
+		SparseImage create() const;
+	};
+
+	struct ReadbackManagerMaker : public ::DkReadbackManagerMaker
+	{
+		ReadbackManagerMaker(DkDevice device) noexcept : DkReadbackManagerMaker{} { ::dkReadbackManagerMakerDefaults(this, device); }
+		ReadbackManagerMaker& setStagingSize(uint32_t stagingSize) noexcept { this->stagingSize = stagingSize; return *this; }
+		ReadbackManagerMaker& setMaxReadbacks(uint32_t maxReadbacks) noexcept { this->maxReadbacks = maxReadbacks; return *this; }
+		ReadbackManager create() const;
+	};
+
+	struct DescriptorPoolMaker : public ::DkDescriptorPoolMaker
+	{
+		DescriptorPoolMaker(DkDevice device, uint32_t numDescriptors) noexcept : DkDescriptorPoolMaker{} { ::dkDescriptorPoolMakerDefaults(this, device, numDescriptors); }
+		DescriptorPoolMaker& setNumDescriptors(uint32_t numDescriptors) noexcept { this->numDescriptors = numDescriptors; return *this; }
+		DescriptorPool create() const;
+	};
+
+	struct BindlessTableMaker : public ::DkBindlessTableMaker
+	{
+		BindlessTableMaker(DkDevice device, uint32_t numDescriptors) noexcept : DkBindlessTableMaker{} { ::dkBindlessTableMakerDefaults(this, device, numDescriptors); }
+		BindlessTableMaker& setNumDescriptors(uint32_t numDescriptors) noexcept { this->numDescriptors = numDescriptors; return *this; }
+		BindlessTable create() const;
+	};
+
+	struct ShaderCodeCacheMaker : public ::DkShaderCodeCacheMaker
+	{
+		ShaderCodeCacheMaker(DkDevice device) noexcept : DkShaderCodeCacheMaker{} { ::dkShaderCodeCacheMakerDefaults(this, device); }
+		ShaderCodeCacheMaker& setMaxEntries(uint32_t maxEntries) noexcept { this->maxEntries = maxEntries; return *this; }
+		ShaderCodeCacheMaker& setBlockSize(uint32_t blockSize) noexcept { this->blockSize = blockSize; return *this; }
+		ShaderCodeCache create() const;
+	};
+
+	struct ShaderArchiveMaker : public ::DkShaderArchiveMaker
+	{
+		ShaderArchiveMaker(DkDevice device) noexcept : DkShaderArchiveMaker{} { ::dkShaderArchiveMakerDefaults(this, device); }
+		ShaderArchiveMaker& setData(const void* data, uint32_t dataSize) noexcept { this->data = data; this->dataSize = dataSize; return *this; }
+		ShaderArchiveMaker& setFd(int fd) noexcept { this->fd = fd; return *this; }
+		ShaderArchiveMaker& setBlockSize(uint32_t blockSize) noexcept { this->blockSize = blockSize; return *this; }
+		ShaderArchive create() const;
+	};
+
+	struct PipelineMaker : public ::DkPipelineMaker
+	{
+		PipelineMaker(DkDevice device) noexcept : DkPipelineMaker{} { ::dkPipelineMakerDefaults(this, device); }
+		PipelineMaker& setShaders(uint32_t stageMask, detail::ArrayProxy<DkShader const* const> shaders) noexcept
+		{
+			this->stageMask = stageMask;
+			this->shaders = shaders.data();
+			this->numShaders = shaders.size();
+			return *this;
+		}
+		PipelineMaker& setRasterizerState(DkRasterizerState const* state) noexcept { this->rasterizerState = state; return *this; }
+		PipelineMaker& setMultisampleState(DkMultisampleState const* state) noexcept { this->multisampleState = state; return *this; }
+		PipelineMaker& setColorState(DkColorState const* state) noexcept { this->colorState = state; return *this; }
+		PipelineMaker& setColorWriteState(DkColorWriteState const* state) noexcept { this->colorWriteState = state; return *this; }
+		PipelineMaker& setBlendStates(detail::ArrayProxy<DkBlendState const> states) noexcept
+		{
+			this->blendStates = states.data();
+			this->numBlendStates = states.size();
+			return *this;
+		}
+		PipelineMaker& setDepthStencilState(DkDepthStencilState const* state) noexcept { this->depthStencilState = state; return *this; }
+		PipelineMaker& setVtxAttribState(detail::ArrayProxy<DkVtxAttribState const> attribs) noexcept
+		{
+			this->vtxAttribs = attribs.data();
+			this->numVtxAttribs = attribs.size();
+			return *this;
+		}
+		PipelineMaker& setVtxBufferState(detail::ArrayProxy<DkVtxBufferState const> buffers) noexcept
+		{
+			this->vtxBuffers = buffers.data();
+			this->numVtxBuffers = buffers.size();
+			return *this;
+		}
+		Pipeline create() const;
+	};
+
+	struct ShaderLoaderMaker : public ::DkShaderLoaderMaker
+	{
+		ShaderLoaderMaker(DkDevice device, DkShaderArena arena) noexcept : DkShaderLoaderMaker{} { ::dkShaderLoaderMakerDefaults(this, device, arena); }
+		ShaderLoaderMaker& setUserData(void* userData) noexcept { this->userData = userData; return *this; }
+		ShaderLoaderMaker& setCbDone(DkShaderLoadDoneFunc cbDone) noexcept { this->cbDone = cbDone; return *this; }
+		ShaderLoaderMaker& setNumThreads(uint32_t numThreads) noexcept { this->numThreads = numThreads; return *this; }
+		ShaderLoaderMaker& setMaxQueuedJobs(uint32_t maxQueuedJobs) noexcept { this->maxQueuedJobs = maxQueuedJobs; return *this; }
+		ShaderLoaderMaker& setThreadPriority(int threadPriority) noexcept { this->threadPriority = threadPriority; return *this; }
+		ShaderLoaderMaker& setThreadCpuMask(uint32_t threadCpuMask) noexcept { this->threadCpuMask = threadCpuMask; return *this; }
+		ShaderLoader create() const;
+	};
+
 	inline Device DeviceMaker::create() const
 	{
 		return Device{::dkDeviceCreate(this)};
@@ -581,6 +808,41 @@ namespace dk
 		return ::dkDeviceGetCurrentTimestampInNs(*this);
 	}
 
+	inline void Device::getSlabStats(DkSlabStats& out)
+	{
+		::dkDeviceGetSlabStats(*this, &out);
+	}
+
+	inline void Device::getMemoryStats(DkMemoryStats& out)
+	{
+		::dkDeviceGetMemoryStats(*this, &out);
+	}
+
+	inline void Device::setMemoryBudget(uint64_t budget, DkMemoryBudgetFunc func, void* userData)
+	{
+		::dkDeviceSetMemoryBudget(*this, budget, func, userData);
+	}
+
+	inline DkGpuAddr Device::getSamplerCacheGpuAddr()
+	{
+		return ::dkDeviceGetSamplerCacheGpuAddr(*this);
+	}
+
+	inline uint32_t Device::acquireSampler(DkSampler const& sampler)
+	{
+		return ::dkDeviceAcquireSampler(*this, &sampler);
+	}
+
+	inline void Device::releaseSampler(uint32_t id)
+	{
+		::dkDeviceReleaseSampler(*this, id);
+	}
+
+	inline void Device::commitSamplers(DkCmdBuf cmdbuf)
+	{
+		::dkDeviceCommitSamplers(*this, cmdbuf);
+	}
+
 	inline MemBlock MemBlockMaker::create() const
 	{
 		return MemBlock{::dkMemBlockCreate(this)};
@@ -612,6 +874,21 @@ namespace dk
 		return ::dkMemBlockFlushCpuCache(*this, offset, size);
 	}
 
+	inline void MemBlock::markDirty(uint32_t offset, uint32_t size)
+	{
+		::dkMemBlockMarkDirty(*this, offset, size);
+	}
+
+	inline DkResult MemBlock::flushDirty()
+	{
+		return ::dkMemBlockFlushDirty(*this);
+	}
+
+	inline DkResult MemBlock::flushCpuCacheRanges(detail::ArrayProxy<DkMemRange const> ranges)
+	{
+		return ::dkMemBlockFlushCpuCacheRanges(ranges.data(), ranges.size());
+	}
+
 	inline DkResult Fence::wait(int64_t timeout_ns)
 	{
 		return ::dkFenceWait(this, timeout_ns);
@@ -663,6 +940,11 @@ namespace dk
 		::dkCmdBufClear(*this);
 	}
 
+	inline void CmdBuf::getProgramBindStats(DkProgramBindStats& out)
+	{
+		::dkCmdBufGetProgramBindStats(*this, &out);
+	}
+
 	inline void CmdBuf::beginCaptureCmds(uint32_t* storage, uint32_t max_words)
 	{
 		::dkCmdBufBeginCaptureCmds(*this, storage, max_words);
@@ -798,6 +1080,11 @@ namespace dk
 		::dkCmdBufBindVtxBufferState(*this, buffers.data(), buffers.size());
 	}
 
+	inline void CmdBuf::bindPipeline(DkPipeline pipeline, DkPipeline prev)
+	{
+		::dkCmdBufBindPipeline(*this, pipeline, prev);
+	}
+
 	inline void CmdBuf::bindVtxBuffer(uint32_t id, DkGpuAddr bufAddr, uint32_t bufSize)
 	{
 		::dkCmdBufBindVtxBuffer(*this, id, bufAddr, bufSize);
@@ -1006,6 +1293,16 @@ namespace dk
 		::dkCmdBufCopyBuffer(*this, srcAddr, dstAddr, size);
 	}
 
+	inline void CmdBuf::fillBuffer(DkGpuAddr addr, uint32_t size, uint32_t value)
+	{
+		::dkCmdBufFillBuffer(*this, addr, size, value);
+	}
+
+	inline void CmdBuf::fillImage(DkImageView const& dstView, DkImageRect const& dstRect, const void* value)
+	{
+		::dkCmdBufFillImage(*this, &dstView, &dstRect, value);
+	}
+
 	inline void CmdBuf::copyImage(DkImageView const& srcView, DkImageRect const& srcRect, DkImageView const& dstView, DkImageRect const& dstRect, uint32_t flags)
 	{
 		::dkCmdBufCopyImage(*this, &srcView, &srcRect, &dstView, &dstRect, flags);
@@ -1021,11 +1318,21 @@ namespace dk
 		::dkCmdBufResolveImage(*this, &srcView, &dstView);
 	}
 
+	inline void CmdBuf::generateMipmaps(DkImage const& image, uint32_t baseLevel, uint32_t levelCount, uint32_t flags)
+	{
+		::dkCmdBufGenerateMipmaps(*this, &image, baseLevel, levelCount, flags);
+	}
+
 	inline void CmdBuf::copyBufferToImage(DkCopyBuf const& src, DkImageView const& dstView, DkImageRect const& dstRect, uint32_t flags)
 	{
 		::dkCmdBufCopyBufferToImage(*this, &src, &dstView, &dstRect, flags);
 	}
 
+	inline void CmdBuf::copyBufferToImageMips(DkGpuAddr src, DkImage const& dstImage, detail::ArrayProxy<DkCopyBufRegion const> regions)
+	{
+		::dkCmdBufCopyBufferToImageMips(*this, src, &dstImage, regions.data(), regions.size());
+	}
+
 	inline void CmdBuf::copyImageToBuffer(DkImageView const& srcView, DkImageRect const& srcRect, DkCopyBuf const& dst, uint32_t flags)
 	{
 		::dkCmdBufCopyImageToBuffer(*this, &srcView, &srcRect, &dst, flags);
@@ -1102,6 +1409,11 @@ namespace dk
 		::dkShaderInitialize(&obj, this);
 	}
 
+	inline DkResult ShaderModuleMaker::load(detail::ArrayProxy<Shader> shaders, uint32_t* numShaders) const
+	{
+		return ::dkShaderModuleLoad(this, shaders.data(), shaders.size(), numShaders);
+	}
+
 	inline bool Shader::isValid() const
 	{
 		return ::dkShaderIsValid(this);
@@ -1127,6 +1439,16 @@ namespace dk
 		return ::dkImageLayoutGetAlignment(this);
 	}
 
+	inline uint64_t ImageLayout::getLevelOffset(uint32_t mipLevel) const
+	{
+		return ::dkImageLayoutGetLevelOffset(this, mipLevel);
+	}
+
+	inline uint64_t ImageLayout::getLayerSize() const
+	{
+		return ::dkImageLayoutGetLayerSize(this);
+	}
+
 	inline void Image::initialize(ImageLayout const& layout, DkMemBlock memBlock, uint32_t offset)
 	{
 		::dkImageInitialize(this, &layout, memBlock, offset);
@@ -1142,16 +1464,36 @@ namespace dk
 		return *static_cast<ImageLayout const*>(::dkImageGetLayout(this));
 	}
 
+	inline void Image::writeTexels(uint32_t mipLevel, DkImageRect const& rect, const void* src, uint32_t rowLength, uint32_t imageHeight) const
+	{
+		::dkImageWriteTexels(this, mipLevel, &rect, src, rowLength, imageHeight);
+	}
+
+	inline void Image::readTexels(uint32_t mipLevel, DkImageRect const& rect, void* dst, uint32_t rowLength, uint32_t imageHeight) const
+	{
+		::dkImageReadTexels(this, mipLevel, &rect, dst, rowLength, imageHeight);
+	}
+
 	inline void ImageDescriptor::initialize(ImageView const& view, bool usesLoadOrStore, bool decayMS)
 	{
 		::dkImageDescriptorInitialize(this, &view, usesLoadOrStore, decayMS);
 	}
 
+	inline void ImageDescriptor::initializeBatch(ImageDescriptor* objs, detail::ArrayProxy<DkImageView const> views, bool usesLoadOrStore, bool decayMS)
+	{
+		::dkImageDescriptorInitializeBatch(objs, views.data(), views.size(), usesLoadOrStore, decayMS);
+	}
+
 	inline void SamplerDescriptor::initialize(Sampler const& sampler)
 	{
 		::dkSamplerDescriptorInitialize(this, &sampler);
 	}
 
+	inline void SamplerDescriptor::initializeBatch(SamplerDescriptor* objs, detail::ArrayProxy<DkSampler const> samplers)
+	{
+		::dkSamplerDescriptorInitializeBatch(objs, samplers.data(), samplers.size());
+	}
+
 	inline MultisampleState& MultisampleState::setLocations(detail::ArrayProxy<DkSampleLocation const> locations)
 	{
 		::dkMultisampleStateSetLocations(this, locations.data(), locations.size());
@@ -1184,9 +1526,321 @@ namespace dk
 		::dkSwapchainSetSwapInterval(*this, interval);
 	}
 
+	inline ShaderArena ShaderArenaMaker::create() const
+	{
+		return ShaderArena{::dkShaderArenaCreate(this)};
+	}
+
+	inline void ShaderArena::destroy()
+	{
+		::dkShaderArenaDestroy(*this);
+		_clear();
+	}
+
+	inline DkResult ShaderArena::alloc(uint32_t size, void* userData, DkShaderCode& out)
+	{
+		return ::dkShaderArenaAlloc(*this, size, userData, &out);
+	}
+
+	inline DkResult ShaderArena::load(const void* dksh, uint32_t dkshSize, void* userData, DkShaderCode& out)
+	{
+		return ::dkShaderArenaLoad(*this, dksh, dkshSize, userData, &out);
+	}
+
+	inline void ShaderArena::free(DkShaderCode const& code)
+	{
+		::dkShaderArenaFree(*this, &code);
+	}
+
+	inline uint32_t ShaderArena::compact(DkShaderArenaRelocFunc func, void* userData)
+	{
+		return ::dkShaderArenaCompact(*this, func, userData);
+	}
+
+	inline Defragmenter DefragmenterMaker::create() const
+	{
+		return Defragmenter{::dkDefragmenterCreate(this)};
+	}
+
+	inline void Defragmenter::destroy()
+	{
+		::dkDefragmenterDestroy(*this);
+		_clear();
+	}
+
+	inline uint32_t Defragmenter::plan(detail::ArrayProxy<DkDefragAlloc const> allocs)
+	{
+		return ::dkDefragmenterPlan(*this, allocs.data(), allocs.size());
+	}
+
+	inline uint32_t Defragmenter::recordBatch(DkCmdBuf cmdbuf, uint64_t timeBudgetNs)
+	{
+		return ::dkDefragmenterRecordBatch(*this, cmdbuf, timeBudgetNs);
+	}
+
+	inline bool Defragmenter::isDone()
+	{
+		return ::dkDefragmenterIsDone(*this);
+	}
+
+	inline detail::ArrayProxy<DkDefragRelocation const> Defragmenter::getRelocations()
+	{
+		uint32_t numRelocations = 0;
+		DkDefragRelocation const* relocations = ::dkDefragmenterGetRelocations(*this, &numRelocations);
+		return { numRelocations, relocations };
+	}
+
+	inline SparseImage SparseImageMaker::create() const
+	{
+		return SparseImage{::dkSparseImageCreate(this)};
+	}
+
+	inline void SparseImage::destroy()
+	{
+		::dkSparseImageDestroy(*this);
+		_clear();
+	}
+
+	inline uint32_t SparseImage::getPageSize()
+	{
+		return ::dkSparseImageGetPageSize(*this);
+	}
+
+	inline void SparseImage::initImage(Image& out)
+	{
+		::dkSparseImageInitImage(*this, &out);
+	}
+
+	inline DkResult SparseImage::commit(uint64_t offset, uint64_t size, DkMemBlock memBlock, uint32_t memOffset)
+	{
+		return ::dkSparseImageCommit(*this, offset, size, memBlock, memOffset);
+	}
+
+	inline void SparseImage::decommit(uint64_t offset, uint64_t size)
+	{
+		::dkSparseImageDecommit(*this, offset, size);
+	}
+
+	inline ReadbackManager ReadbackManagerMaker::create() const
+	{
+		return ReadbackManager{::dkReadbackManagerCreate(this)};
+	}
+
+	inline void ReadbackManager::destroy()
+	{
+		::dkReadbackManagerDestroy(*this);
+		_clear();
+	}
+
+	inline DkResult ReadbackManager::readBuffer(DkCmdBuf cmdbuf, DkGpuAddr srcAddr, uint32_t size, DkReadback& out)
+	{
+		return ::dkReadbackManagerReadBuffer(*this, cmdbuf, srcAddr, size, &out);
+	}
+
+	inline DkResult ReadbackManager::readImage(DkCmdBuf cmdbuf, DkImageView const& srcView, DkImageRect const& srcRect, DkReadback& out, uint32_t flags)
+	{
+		return ::dkReadbackManagerReadImage(*this, cmdbuf, &srcView, &srcRect, flags, &out);
+	}
+
+	inline bool ReadbackManager::isReady(DkReadback const& readback)
+	{
+		return ::dkReadbackManagerIsReady(*this, &readback);
+	}
+
+	inline DkResult ReadbackManager::wait(DkReadback const& readback, int64_t timeout_ns)
+	{
+		return ::dkReadbackManagerWait(*this, &readback, timeout_ns);
+	}
+
+	inline const void* ReadbackManager::getData(DkReadback const& readback, uint32_t* size)
+	{
+		return ::dkReadbackManagerGetData(*this, &readback, size);
+	}
+
+	inline void ReadbackManager::release(DkReadback const& readback)
+	{
+		::dkReadbackManagerRelease(*this, &readback);
+	}
+
+	inline DescriptorPool DescriptorPoolMaker::create() const
+	{
+		return DescriptorPool{::dkDescriptorPoolCreate(this)};
+	}
+
+	inline void DescriptorPool::destroy()
+	{
+		::dkDescriptorPoolDestroy(*this);
+		_clear();
+	}
+
+	inline DkGpuAddr DescriptorPool::getGpuAddr()
+	{
+		return ::dkDescriptorPoolGetGpuAddr(*this);
+	}
+
+	inline uint32_t DescriptorPool::getNumDescriptors()
+	{
+		return ::dkDescriptorPoolGetNumDescriptors(*this);
+	}
+
+	inline uint32_t DescriptorPool::allocImage(DkImageDescriptor const& desc)
+	{
+		return ::dkDescriptorPoolAllocImage(*this, &desc);
+	}
+
+	inline uint32_t DescriptorPool::allocSampler(DkSamplerDescriptor const& desc)
+	{
+		return ::dkDescriptorPoolAllocSampler(*this, &desc);
+	}
+
+	inline void DescriptorPool::release(uint32_t id)
+	{
+		::dkDescriptorPoolRelease(*this, id);
+	}
+
+	inline void DescriptorPool::commit(DkCmdBuf cmdbuf)
+	{
+		::dkDescriptorPoolCommit(*this, cmdbuf);
+	}
+
+	inline BindlessTable BindlessTableMaker::create() const
+	{
+		return BindlessTable{::dkBindlessTableCreate(this)};
+	}
+
+	inline void BindlessTable::destroy()
+	{
+		::dkBindlessTableDestroy(*this);
+		_clear();
+	}
+
+	inline DkGpuAddr BindlessTable::getGpuAddr()
+	{
+		return ::dkBindlessTableGetGpuAddr(*this);
+	}
+
+	inline uint32_t BindlessTable::getNumDescriptors()
+	{
+		return ::dkBindlessTableGetNumDescriptors(*this);
+	}
+
+	inline void BindlessTable::setImages(uint32_t first, detail::ArrayProxy<DkImageDescriptor const> descs)
+	{
+		::dkBindlessTableSetImages(*this, first, descs.data(), descs.size());
+	}
+
+	inline void BindlessTable::flush(DkCmdBuf cmdbuf)
+	{
+		::dkBindlessTableFlush(*this, cmdbuf);
+	}
+
+	inline ShaderCodeCache ShaderCodeCacheMaker::create() const
+	{
+		return ShaderCodeCache{::dkShaderCodeCacheCreate(this)};
+	}
+
+	inline void ShaderCodeCache::destroy()
+	{
+		::dkShaderCodeCacheDestroy(*this);
+		_clear();
+	}
+
+	inline uint32_t ShaderCodeCache::getNumEntries()
+	{
+		return ::dkShaderCodeCacheGetNumEntries(*this);
+	}
+
+	inline DkResult ShaderCodeCache::load(const void* dksh, uint32_t dkshSize, detail::ArrayProxy<Shader> shaders, uint32_t* numShaders)
+	{
+		return ::dkShaderCodeCacheLoad(*this, dksh, dkshSize, shaders.data(), shaders.size(), numShaders);
+	}
+
+	inline void ShaderCodeCache::release(detail::ArrayProxy<Shader const> shaders)
+	{
+		::dkShaderCodeCacheRelease(*this, shaders.data(), shaders.size());
+	}
+
+	inline ShaderArchive ShaderArchiveMaker::create() const
+	{
+		return ShaderArchive{::dkShaderArchiveCreate(this)};
+	}
+
+	inline void ShaderArchive::destroy()
+	{
+		::dkShaderArchiveDestroy(*this);
+		_clear();
+	}
+
+	inline uint32_t ShaderArchive::getNumModules()
+	{
+		return ::dkShaderArchiveGetNumModules(*this);
+	}
+
+	inline uint32_t ShaderArchive::findModule(const char* name)
+	{
+		return ::dkShaderArchiveFindModule(*this, name);
+	}
+
+	inline DkResult ShaderArchive::getShader(uint32_t moduleId, uint32_t programId, DkShader const*& out)
+	{
+		return ::dkShaderArchiveGetShader(*this, moduleId, programId, &out);
+	}
+
+	inline Pipeline PipelineMaker::create() const
+	{
+		return Pipeline{::dkPipelineCreate(this)};
+	}
+
+	inline void Pipeline::destroy()
+	{
+		::dkPipelineDestroy(*this);
+		_clear();
+	}
+
+	inline uint32_t Pipeline::getNumWords()
+	{
+		return ::dkPipelineGetNumWords(*this);
+	}
+
+	inline ShaderLoader ShaderLoaderMaker::create() const
+	{
+		return ShaderLoader{::dkShaderLoaderCreate(this)};
+	}
+
+	inline void ShaderLoader::destroy()
+	{
+		::dkShaderLoaderDestroy(*this);
+		_clear();
+	}
+
+	inline void ShaderLoader::submit(detail::ArrayProxy<DkShaderLoadJob* const> jobs)
+	{
+		::dkShaderLoaderSubmit(*this, jobs.data(), jobs.size());
+	}
+
+	inline void ShaderLoader::wait(DkShaderLoadJob const& job)
+	{
+		::dkShaderLoaderWait(*this, &job);
+	}
+
+	inline void ShaderLoader::finish(DkCmdBuf cmdbuf)
+	{
+		::dkShaderLoaderFinish(*this, cmdbuf);
+	}
+
 	using UniqueDevice = detail::UniqueHandle<Device>;
 	using UniqueMemBlock = detail::UniqueHandle<MemBlock>;
 	using UniqueCmdBuf = detail::UniqueHandle<CmdBuf>;
 	using UniqueQueue = detail::UniqueHandle<Queue>;
 	using UniqueSwapchain = detail::UniqueHandle<Swapchain>;
+	using UniqueShaderArena = detail::UniqueHandle<ShaderArena>;
+	using UniqueDefragmenter = detail::UniqueHandle<Defragmenter>;
+	using UniqueSparseImage = detail::UniqueHandle<SparseImage>;
+	using UniqueReadbackManager = detail::UniqueHandle<ReadbackManager>;
+	using UniqueDescriptorPool = detail::UniqueHandle<DescriptorPool>;
+	using UniqueBindlessTable = detail::UniqueHandle<BindlessTable>;
+	using UniqueShaderCodeCache = detail::UniqueHandle<ShaderCodeCache>;
+	using UniqueShaderArchive = detail::UniqueHandle<ShaderArchive>;
+	using UniquePipeline = detail::UniqueHandle<Pipeline>;
+	using UniqueShaderLoader = detail::UniqueHandle<ShaderLoader>;
 }
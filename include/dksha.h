@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+
+// deko3d shader archive file format
+// This header is public so that external tools can produce archives.
+// File extension: .dksha
+// Packs any number of DKSH modules (see dksh.h) into a single file:
+// - DkshaHeader
+// - DkshaEntry[], sorted by name_hash so that modules can be looked up with a binary search
+// - Name table: the names of the modules (not NUL terminated), checked on every lookup
+//   so that names that merely share a hash with a module are not mistaken for it
+// - Module data. The control section of each module is always stored uncompressed,
+//   while its code section may optionally be compressed. Code sections start at file
+//   offsets that are a multiple of 256 bytes, so that uncompressed code can be copied
+//   (or read) straight into code memory.
+// Module names are hashed using 64-bit FNV-1a.
+
+#define DKSHA_MAGIC UINT32_C(0x41534B44) // DKSA
+
+typedef struct DkshaHeader
+{
+	uint32_t magic; // DKSHA_MAGIC
+	uint32_t header_sz; // sizeof(DkshaHeader)
+	uint32_t entries_off;
+	uint32_t num_entries;
+	uint32_t names_off;
+	uint32_t names_sz;
+} DkshaHeader;
+
+enum
+{
+	DkshaCompression_None = 0,
+	DkshaCompression_Lz4  = 1, // LZ4 block format (no frame)
+};
+
+typedef struct DkshaEntry
+{
+	uint64_t name_hash;
+	uint32_t name_off; // relative to the name table
+	uint32_t name_sz;
+	uint32_t control_off;
+	uint32_t control_sz;
+	uint32_t code_off;
+	uint32_t code_sz;        // uncompressed size
+	uint32_t stored_code_sz; // size as stored in the archive
+	uint32_t compression;
+} DkshaEntry;
+
+#ifdef __cplusplus
+static_assert(sizeof(DkshaHeader)==24, "Wrong size for DkshaHeader");
+static_assert(sizeof(DkshaEntry)==40, "Wrong size for DkshaEntry");
+#endif
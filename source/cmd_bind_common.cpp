@@ -107,11 +107,15 @@ void dkCmdBufBindShaders(DkCmdBuf obj, uint32_t stageMask, DkShader const* const
 		if (shader->m_stage == DkStage_Vertex)
 		{
 			if (hdr.vert.alt_num_gprs)
+			{
+				obj->trackProgramBind(0, shader->m_id);
 				w << Macro(BindProgram, 0, shader->m_id, hdr.vert.alt_entrypoint, hdr.vert.alt_num_gprs);
+			}
 			else
 				w << CmdInline(3D, SetProgram::Config{0}, 0); // disable VertexA
 		}
 
+		obj->trackProgramBind(1+unsigned(shader->m_stage), shader->m_id);
 		w << Macro(BindProgram, 1+unsigned(shader->m_stage),
 			shader->m_id,
 			hdr.entrypoint,
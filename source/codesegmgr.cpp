@@ -48,6 +48,7 @@ bool CodeSegMgr::allocSpace(uint32_t size, DkGpuAddr& out_addr)
 		return false;
 
 	out_addr = m_segmentIova + bigPageSize*node->m_offset;
+	getDevice()->trackMemStat(MemStat_CodeSegment, uint64_t(numPages)*bigPageSize, true);
 	if (node->m_numPages == numPages)
 	{
 		// Sizes match exactly, so remove and free this node
@@ -66,10 +67,8 @@ bool CodeSegMgr::allocSpace(uint32_t size, DkGpuAddr& out_addr)
 
 void CodeSegMgr::freeSpace(DkGpuAddr addr, uint32_t size) noexcept
 {
-	uint32_t bigPageSize = getDevice()->getGpuInfo().bigPageSize;
-	uint32_t numPages = (size + bigPageSize - 1) / bigPageSize;
+	// Space is never given back yet, so MemStat_CodeSegment keeps counting it
+	// (the stat must only go down once the space is actually released)
 	MutexHolder m{m_mutex};
 	// TODO
-	(void)bigPageSize;
-	(void)numPages;
 }
@@ -0,0 +1,98 @@
+#pragma once
+#include <string.h>
+#include <stdint.h>
+
+namespace dk::detail
+{
+
+// Keeps a small sorted list of non-overlapping byte ranges, aligned to cache lines.
+// Ranges that overlap or touch are merged on insertion; once the list is full the
+// two closest ranges are coalesced, trading a slightly bigger flush for bounded cost.
+class DirtyRangeTracker
+{
+public:
+	static constexpr unsigned s_maxRanges = 16;
+	static constexpr uint32_t s_lineSize = 64;
+
+private:
+	struct Range
+	{
+		uint32_t start;
+		uint32_t end;
+	};
+
+	uint32_t m_numRanges;
+	Range m_ranges[s_maxRanges+1];
+
+	void coalesceClosest() noexcept
+	{
+		unsigned best = 0;
+		uint32_t bestGap = UINT32_MAX;
+		for (unsigned i = 0; i+1 < m_numRanges; i ++)
+		{
+			uint32_t gap = m_ranges[i+1].start - m_ranges[i].end;
+			if (gap < bestGap)
+			{
+				best = i;
+				bestGap = gap;
+			}
+		}
+
+		m_ranges[best].end = m_ranges[best+1].end;
+		memmove(&m_ranges[best+1], &m_ranges[best+2], (m_numRanges-best-2)*sizeof(Range));
+		m_numRanges --;
+	}
+
+public:
+	constexpr DirtyRangeTracker() noexcept : m_numRanges{}, m_ranges{} { }
+	void* operator new(size_t size, void* p) noexcept { return p; }
+
+	constexpr bool isEmpty() const noexcept { return m_numRanges == 0; }
+	constexpr uint32_t getNumRanges() const noexcept { return m_numRanges; }
+
+	void add(uint32_t start, uint32_t end) noexcept
+	{
+		start &= ~(s_lineSize-1);
+		end = (end + s_lineSize-1) &~ (s_lineSize-1);
+
+		// Skip past all ranges that end before the new one starts
+		unsigned i = 0;
+		while (i < m_numRanges && m_ranges[i].end < start)
+			i ++;
+
+		// Absorb all ranges overlapping or touching the new one
+		unsigned j = i;
+		for (; j < m_numRanges && m_ranges[j].start <= end; j ++)
+		{
+			if (m_ranges[j].start < start) start = m_ranges[j].start;
+			if (m_ranges[j].end > end)     end   = m_ranges[j].end;
+		}
+
+		if (i == j)
+		{
+			// Nothing to merge with: insert a new range
+			memmove(&m_ranges[i+1], &m_ranges[i], (m_numRanges-i)*sizeof(Range));
+			m_numRanges ++;
+		}
+		else if (j > i+1)
+		{
+			// Several ranges were merged: remove the now redundant ones
+			memmove(&m_ranges[i+1], &m_ranges[j], (m_numRanges-j)*sizeof(Range));
+			m_numRanges -= j-i-1;
+		}
+
+		m_ranges[i] = { start, end };
+		if (m_numRanges > s_maxRanges)
+			coalesceClosest();
+	}
+
+	template <typename Func>
+	void flush(Func&& func) noexcept
+	{
+		for (unsigned i = 0; i < m_numRanges; i ++)
+			func(m_ranges[i].start, m_ranges[i].end - m_ranges[i].start);
+		m_numRanges = 0;
+	}
+};
+
+}
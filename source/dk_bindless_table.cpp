@@ -0,0 +1,132 @@
+#include "dk_bindless_table.h"
+#include "dk_device.h"
+#include "dk_memblock.h"
+
+using namespace dk::detail;
+
+DkResult BindlessTable::initialize()
+{
+	uint32_t maskWords = (m_numDescriptors + 31) / 32;
+	m_descriptors = static_cast<Descriptor*>(allocMem(m_numDescriptors*sizeof(Descriptor)));
+	m_dirtyMask = static_cast<uint32_t*>(allocMem(maskWords*sizeof(uint32_t)));
+	if (!m_descriptors || !m_dirtyMask)
+		return DkResult_OutOfMemory;
+
+	memset(m_descriptors, 0, m_numDescriptors*sizeof(Descriptor));
+	memset(m_dirtyMask, 0, maskWords*sizeof(uint32_t));
+
+	// The CPU never touches the GPU copy of the table: all updates go through the command buffer
+	uint32_t size = (m_numDescriptors*s_descriptorSize + DK_MEMBLOCK_ALIGNMENT - 1) &~ (DK_MEMBLOCK_ALIGNMENT - 1);
+	m_memBlock = new(getDevice()) MemBlock(getDevice());
+	DkResult res = m_memBlock->initialize(DkMemBlockFlags_CpuUncached | DkMemBlockFlags_GpuCached | DkMemBlockFlags_ZeroFillInit, nullptr, size);
+	if (res != DkResult_Success)
+	{
+		delete m_memBlock;
+		m_memBlock = nullptr;
+	}
+	return res;
+}
+
+void BindlessTable::destroy()
+{
+	if (m_memBlock)
+	{
+		delete m_memBlock;
+		m_memBlock = nullptr;
+	}
+
+	if (m_dirtyMask)
+	{
+		freeMem(m_dirtyMask);
+		m_dirtyMask = nullptr;
+	}
+
+	if (m_descriptors)
+	{
+		freeMem(m_descriptors);
+		m_descriptors = nullptr;
+	}
+}
+
+DkGpuAddr BindlessTable::getGpuAddr() const
+{
+	return m_memBlock->getGpuAddrPitch();
+}
+
+void BindlessTable::set(uint32_t first, const void* descs, uint32_t count)
+{
+	MutexHolder m{m_mutex};
+	memcpy(&m_descriptors[first], descs, count*sizeof(Descriptor));
+
+	for (uint32_t id = first; id < first + count; id ++)
+	{
+		if (!isDirty(id))
+		{
+			m_dirtyMask[id/32] |= 1U << (id%32);
+			m_numDirty ++;
+		}
+	}
+
+	if (m_dirtyBegin == m_dirtyEnd)
+	{
+		m_dirtyBegin = first;
+		m_dirtyEnd = first + count;
+	}
+	else
+	{
+		if (first < m_dirtyBegin)
+			m_dirtyBegin = first;
+		if (first + count > m_dirtyEnd)
+			m_dirtyEnd = first + count;
+	}
+}
+
+DkBindlessTable dkBindlessTableCreate(DkBindlessTableMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_ZERO(maker->numDescriptors);
+
+	DkBindlessTable obj = new(maker->device) BindlessTable(*maker);
+	DkResult res = obj->initialize();
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkBindlessTableDestroy(DkBindlessTable obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+DkGpuAddr dkBindlessTableGetGpuAddr(DkBindlessTable obj)
+{
+	return obj->getGpuAddr();
+}
+
+uint32_t dkBindlessTableGetNumDescriptors(DkBindlessTable obj)
+{
+	return obj->getNumDescriptors();
+}
+
+void dkBindlessTableSetImages(DkBindlessTable obj, uint32_t first, DkImageDescriptor const descs[], uint32_t count)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL_ARRAY(descs, count);
+	DK_DEBUG_BAD_INPUT(first > obj->getNumDescriptors() || count > obj->getNumDescriptors() - first, "descriptor range out of bounds");
+	if (!count)
+		return;
+
+	obj->set(first, descs, count);
+}
+
+void dkBindlessTableFlush(DkBindlessTable obj, DkCmdBuf cmdbuf)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(cmdbuf);
+	obj->flush(cmdbuf);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+
+class BindlessTable : public ObjBase
+{
+public:
+	static constexpr uint32_t s_descriptorSize = 32;
+
+	// Largest number of descriptors uploaded by a single dkCmdBufPushData call
+	static constexpr uint32_t s_maxPushDescriptors = 0x7FFC / s_descriptorSize;
+
+	// Past this many dirty descriptors, invalidating the whole texture header
+	// cache is cheaper than invalidating each descriptor's cache line
+	static constexpr uint32_t s_maxLineInvalidations = 32;
+
+private:
+	struct Descriptor
+	{
+		uint32_t m_words[s_descriptorSize/4];
+	};
+
+	Mutex m_mutex;
+	uint32_t m_numDescriptors;
+	uint32_t m_numDirty;
+	uint32_t m_dirtyBegin;
+	uint32_t m_dirtyEnd;
+
+	DkMemBlock m_memBlock;
+	Descriptor* m_descriptors; // CPU side copy, uploaded in-band when flushing
+	uint32_t* m_dirtyMask;
+
+	bool isDirty(uint32_t id) const noexcept
+	{
+		return m_dirtyMask[id/32] & (1U << (id%32));
+	}
+
+public:
+	constexpr BindlessTable(DkBindlessTableMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_numDescriptors{m.numDescriptors}, m_numDirty{}, m_dirtyBegin{}, m_dirtyEnd{},
+		m_memBlock{}, m_descriptors{}, m_dirtyMask{} { }
+	~BindlessTable() { destroy(); }
+
+	DkResult initialize() noexcept;
+	void destroy();
+
+	DkGpuAddr getGpuAddr() const noexcept;
+	constexpr uint32_t getNumDescriptors() const noexcept { return m_numDescriptors; }
+
+	void set(uint32_t first, const void* descs, uint32_t count) noexcept;
+	void flush(DkCmdBuf cmdbuf) noexcept; // in gpu_base.cpp
+};
+
+}
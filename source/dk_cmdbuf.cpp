@@ -78,6 +78,9 @@ void CmdBuf::clear()
 	m_ctrlPos = nullptr;
 	m_ctrlEnd = nullptr;
 
+	// Whatever the GPU has bound by the time the next commands run is unknown
+	memset(m_boundProgramIds, 0, sizeof(m_boundProgramIds));
+
 	// Reset command memory back to the beginning of the chunk added by the last addMemory call
 	if (m_cmdChunkStart)
 	{
@@ -289,6 +292,13 @@ DkCmdList dkCmdBufFinishList(DkCmdBuf obj)
 	return obj->finishList();
 }
 
+void dkCmdBufGetProgramBindStats(DkCmdBuf obj, DkProgramBindStats* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(out);
+	*out = obj->getProgramBindStats();
+}
+
 void dkCmdBufClear(DkCmdBuf obj)
 {
 	DK_ENTRYPOINT(obj);
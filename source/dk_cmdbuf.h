@@ -46,11 +46,17 @@ class CmdBuf : public ObjBase
 	void *m_ctrlStart, *m_ctrlPos, *m_ctrlEnd;
 	DkGpuAddr m_cmdChunkStartIova, m_cmdStartIova;
 	maxwell::CmdWord *m_cmdChunkStart, *m_cmdStart, *m_cmdPos, *m_cmdEnd;
+
+	// Program IDs last bound to each BindProgram slot (VertexA, VertexB..Fragment),
+	// as seen from this command buffer. Used to keep track of BindProgram fast path usage.
+	uint32_t m_boundProgramIds[6];
+	DkProgramBindStats m_programBindStats;
 public:
 	constexpr CmdBuf(DkCmdBufMaker const& maker, uint32_t rw = 0) noexcept : ObjBase{maker.device},
 		m_userData{maker.userData}, m_cbAddMem{maker.cbAddMem}, m_numReservedWords{rw}, m_hasFlushFunc{false}, m_isCapturing{false},
 		m_ctrlChunkCur{}, m_ctrlChunkFree{}, m_ctrlGpfifo{}, m_ctrlStart{}, m_ctrlPos{}, m_ctrlEnd{},
-		m_cmdChunkStartIova{}, m_cmdStartIova{}, m_cmdChunkStart{}, m_cmdStart{}, m_cmdPos{}, m_cmdEnd{} { }
+		m_cmdChunkStartIova{}, m_cmdStartIova{}, m_cmdChunkStart{}, m_cmdStart{}, m_cmdPos{}, m_cmdEnd{},
+		m_boundProgramIds{}, m_programBindStats{} { }
 	~CmdBuf();
 
 	void useGpfifoFlushFunc(GpfifoFlushFunc func, void* data, CtrlCmdHeader* mem, uint32_t maxEntries)
@@ -76,6 +82,20 @@ public:
 	void beginCapture(uint32_t* storage, uint32_t max_words);
 	uint32_t endCapture();
 
+	void trackProgramBind(unsigned slot, uint32_t id) noexcept
+	{
+		if (m_boundProgramIds[slot] == id)
+			m_programBindStats.numFastBinds ++;
+		else
+		{
+			m_programBindStats.numFullBinds ++;
+			m_boundProgramIds[slot] = id;
+		}
+	}
+
+	constexpr uint32_t getBoundProgramId(unsigned slot) const noexcept { return m_boundProgramIds[slot]; }
+	constexpr DkProgramBindStats const& getProgramBindStats() const noexcept { return m_programBindStats; }
+
 	constexpr bool isDirty() const noexcept { return m_cmdStart != m_cmdPos; }
 	constexpr bool isCapturing() const noexcept { return m_isCapturing; }
 	constexpr uint32_t getCmdOffset() const noexcept { return uint32_t((char*)(void*)m_cmdPos - (char*)(void*)m_cmdChunkStart); }
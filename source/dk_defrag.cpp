@@ -0,0 +1,221 @@
+#include "dk_defrag.h"
+#include "dk_memblock.h"
+#include "cmdbuf_writer.h"
+
+#include "engine_3d.h"
+#include "engine_copy.h"
+
+using namespace maxwell;
+using namespace dk::detail;
+
+using Copy = EngineCopy;
+
+namespace
+{
+	// While planning, the newOffset field temporarily holds the alignment of the allocation
+	int compareRelocs(const void* a, const void* b)
+	{
+		auto& lhs = *static_cast<DkDefragRelocation const*>(a);
+		auto& rhs = *static_cast<DkDefragRelocation const*>(b);
+		uintptr_t lhsBlk = reinterpret_cast<uintptr_t>(lhs.memBlock);
+		uintptr_t rhsBlk = reinterpret_cast<uintptr_t>(rhs.memBlock);
+		if (lhsBlk != rhsBlk)
+			return lhsBlk < rhsBlk ? -1 : 1;
+		if (lhs.oldOffset != rhs.oldOffset)
+			return lhs.oldOffset < rhs.oldOffset ? -1 : 1;
+		return 0;
+	}
+}
+
+void Defragmenter::clear()
+{
+	if (m_relocs)
+	{
+		freeMem(m_relocs);
+		m_relocs = nullptr;
+	}
+	m_numRelocs = 0;
+	m_curReloc = 0;
+	m_curProgress = 0;
+}
+
+DkResult Defragmenter::plan(DkDefragAlloc const allocs[], uint32_t numAllocs)
+{
+	clear();
+	if (!numAllocs)
+		return DkResult_Success;
+
+	m_relocs = static_cast<DkDefragRelocation*>(allocMem(numAllocs*sizeof(DkDefragRelocation)));
+	if (!m_relocs)
+		return DkResult_OutOfMemory;
+
+	for (uint32_t i = 0; i < numAllocs; i ++)
+	{
+		DkDefragAlloc const& alloc = allocs[i];
+		DkDefragRelocation& reloc = m_relocs[i];
+		reloc.allocId   = i;
+		reloc.memBlock  = alloc.memBlock;
+		reloc.oldOffset = alloc.offset;
+		reloc.newOffset = alloc.alignment ? alloc.alignment : 1;
+		reloc.size      = alloc.size;
+	}
+
+	// Group allocations by memory block, in ascending address order
+	qsort(m_relocs, numAllocs, sizeof(DkDefragRelocation), compareRelocs);
+
+	// Slide every allocation down as far as its alignment allows. Since all moves
+	// within a block go towards lower addresses and are recorded in ascending order,
+	// no move can ever overwrite data that a later move has yet to read.
+	// The first pass only validates the input, so that a rejected plan never
+	// leaves a partial set of relocations behind for recordBatch to execute.
+	for (int pass = 0; pass < 2; pass ++)
+	{
+		DkMemBlock curBlock = nullptr;
+		uint32_t cursor = 0;
+		for (uint32_t i = 0; i < numAllocs; i ++)
+		{
+			DkDefragRelocation reloc = m_relocs[i];
+			uint32_t align = reloc.newOffset;
+			if (reloc.memBlock != curBlock)
+			{
+				curBlock = reloc.memBlock;
+				cursor = 0;
+			}
+
+			uint32_t newOffset = (cursor + align - 1) &~ (align - 1);
+			cursor = newOffset + reloc.size;
+			if (pass == 0)
+			{
+				if (newOffset > reloc.oldOffset)
+				{
+					clear();
+					return DkResult_BadInput; // overlapping allocations
+				}
+			}
+			else if (newOffset != reloc.oldOffset && reloc.size)
+			{
+				reloc.newOffset = newOffset;
+				m_relocs[m_numRelocs++] = reloc;
+			}
+		}
+	}
+
+	return DkResult_Success;
+}
+
+uint32_t Defragmenter::recordBatch(DkCmdBuf cmdbuf, uint64_t timeBudgetNs)
+{
+	if (isDone())
+		return m_curReloc;
+
+	// Convert the time budget into a byte budget, making sure that forward progress is always made
+	uint64_t budget = timeBudgetNs * m_copyRate / 1000;
+	if (budget > m_maxBatchSize)
+		budget = m_maxBatchSize;
+	if (budget < DK_MEMBLOCK_ALIGNMENT)
+		budget = DK_MEMBLOCK_ALIGNMENT;
+
+	CmdBufWriter w{cmdbuf};
+	w.reserve(1);
+	w << CmdInline(3D, NoOperation{}, 0);
+
+	for (uint32_t numPieces = 0; budget && numPieces < s_maxPiecesPerBatch && !isDone(); numPieces ++)
+	{
+		DkDefragRelocation const& reloc = m_relocs[m_curReloc];
+		DkGpuAddr baseAddr = reloc.memBlock->getGpuAddrPitch();
+
+		// Moves where source and destination overlap are split into pieces no bigger
+		// than the distance between both, so that no single copy reads its own output
+		uint32_t curSize = reloc.size - m_curProgress;
+		uint32_t distance = reloc.oldOffset - reloc.newOffset;
+		if (curSize > distance)
+			curSize = distance;
+		if (curSize > 0x3FFFFF)
+			curSize = 0x3FFFFF;
+		if (curSize > budget)
+			curSize = budget;
+
+		DkGpuAddr srcAddr = baseAddr + reloc.oldOffset + m_curProgress;
+		DkGpuAddr dstAddr = baseAddr + reloc.newOffset + m_curProgress;
+
+		using E = Copy::LaunchDma;
+		w.reserve(9); // one more for extra flush
+		w << Cmd(Copy, OffsetIn{}, Iova(srcAddr), Iova(dstAddr));
+		w << Cmd(Copy, LineLengthIn{}, curSize);
+		w << CmdInline(Copy, LaunchDma{},
+			E::TransferType::NonPipelined | E::FlushEnable{} | E::SrcMemoryLayout::Pitch | E::DstMemoryLayout::Pitch
+		);
+
+		budget -= curSize;
+		m_curProgress += curSize;
+		if (m_curProgress == reloc.size)
+		{
+			m_curReloc ++;
+			m_curProgress = 0;
+		}
+	}
+
+	w << CmdInline(3D, NoOperation{}, 0);
+	return m_curReloc;
+}
+
+DkDefragmenter dkDefragmenterCreate(DkDefragmenterMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_ZERO(maker->maxBatchSize);
+	DK_DEBUG_NON_ZERO(maker->copyRate);
+
+	DkDefragmenter obj = new(maker->device) Defragmenter(*maker);
+	return obj;
+}
+
+void dkDefragmenterDestroy(DkDefragmenter obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+uint32_t dkDefragmenterPlan(DkDefragmenter obj, DkDefragAlloc const allocs[], uint32_t numAllocs)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL_ARRAY(allocs, numAllocs);
+#ifdef DEBUG
+	for (uint32_t i = 0; i < numAllocs; i ++)
+	{
+		DkDefragAlloc const& alloc = allocs[i];
+		DK_DEBUG_NON_NULL(alloc.memBlock);
+		DK_DEBUG_BAD_INPUT(alloc.memBlock->isGpuNoAccess(), "memory block must be GPU accessible");
+		DK_DEBUG_BAD_INPUT(alloc.alignment & (alloc.alignment - 1), "alignment must be a power of two");
+		DK_DEBUG_BAD_INPUT(alloc.offset + alloc.size > alloc.memBlock->getSize(), "allocation out of bounds");
+	}
+#endif
+
+	DkResult res = obj->plan(allocs, numAllocs);
+	if (res != DkResult_Success)
+	{
+		DK_ERROR(res, "failed to plan defragmentation");
+		return 0;
+	}
+	return obj->getNumRelocs();
+}
+
+uint32_t dkDefragmenterRecordBatch(DkDefragmenter obj, DkCmdBuf cmdbuf, uint64_t timeBudgetNs)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(cmdbuf);
+	return obj->recordBatch(cmdbuf, timeBudgetNs);
+}
+
+bool dkDefragmenterIsDone(DkDefragmenter obj)
+{
+	DK_ENTRYPOINT(obj);
+	return obj->isDone();
+}
+
+DkDefragRelocation const* dkDefragmenterGetRelocations(DkDefragmenter obj, uint32_t* numRelocations)
+{
+	DK_ENTRYPOINT(obj);
+	if (numRelocations)
+		*numRelocations = obj->getNumRelocs();
+	return obj->getRelocs();
+}
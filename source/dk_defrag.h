@@ -0,0 +1,39 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+
+class Defragmenter : public ObjBase
+{
+public:
+	// Bounds the command memory used by a batch, regardless of its byte budget
+	// (small slides of large allocations are split into many small copies)
+	static constexpr uint32_t s_maxPiecesPerBatch = 256;
+
+private:
+	uint32_t m_maxBatchSize;
+	uint32_t m_copyRate;
+
+	DkDefragRelocation* m_relocs;
+	uint32_t m_numRelocs;
+	uint32_t m_curReloc;
+	uint32_t m_curProgress;
+
+	void clear() noexcept;
+
+public:
+	constexpr Defragmenter(DkDefragmenterMaker const& m) noexcept : ObjBase{m.device},
+		m_maxBatchSize{m.maxBatchSize}, m_copyRate{m.copyRate},
+		m_relocs{}, m_numRelocs{}, m_curReloc{}, m_curProgress{} { }
+	~Defragmenter() { clear(); }
+
+	DkResult plan(DkDefragAlloc const allocs[], uint32_t numAllocs) noexcept;
+	uint32_t recordBatch(DkCmdBuf cmdbuf, uint64_t timeBudgetNs) noexcept;
+
+	constexpr bool isDone() const noexcept { return m_curReloc == m_numRelocs; }
+	constexpr uint32_t getNumRelocs() const noexcept { return m_numRelocs; }
+	constexpr DkDefragRelocation const* getRelocs() const noexcept { return m_relocs; }
+};
+
+}
@@ -0,0 +1,283 @@
+#include "dk_descriptor_pool.h"
+#include "dk_device.h"
+#include "dk_memblock.h"
+
+using namespace dk::detail;
+
+DkResult DescriptorPool::initialize()
+{
+	// The hash table is kept at most half full
+	uint32_t tableSize = 1;
+	while (tableSize < 2*m_numDescriptors)
+		tableSize <<= 1;
+	m_tableMask = tableSize - 1;
+
+	m_descriptors = static_cast<Descriptor*>(allocMem(m_numDescriptors*sizeof(Descriptor)));
+	m_slots = static_cast<Slot*>(allocMem(m_numDescriptors*sizeof(Slot)));
+	m_table = static_cast<uint32_t*>(allocMem(tableSize*sizeof(uint32_t)));
+	if (!m_descriptors || !m_slots || !m_table)
+		return DkResult_OutOfMemory;
+
+	memset(m_table, 0, tableSize*sizeof(uint32_t));
+	for (uint32_t i = 0; i < m_numDescriptors; i ++)
+		m_slots[i] = { 0, 0, i+1 };
+	m_firstFree = 0;
+
+	// Descriptors are written straight into uncached memory, so no cache maintenance is needed
+	uint32_t size = (m_numDescriptors*s_descriptorSize + DK_MEMBLOCK_ALIGNMENT - 1) &~ (DK_MEMBLOCK_ALIGNMENT - 1);
+	m_memBlock = new(getDevice()) MemBlock(getDevice());
+	DkResult res = m_memBlock->initialize(DkMemBlockFlags_CpuUncached | DkMemBlockFlags_GpuCached, nullptr, size);
+	if (res != DkResult_Success)
+	{
+		delete m_memBlock;
+		m_memBlock = nullptr;
+		return res;
+	}
+
+	m_gpuDescriptors = static_cast<Descriptor*>(m_memBlock->getCpuAddr());
+	return DkResult_Success;
+}
+
+void DescriptorPool::destroy()
+{
+	if (m_memBlock)
+	{
+		delete m_memBlock;
+		m_memBlock = nullptr;
+	}
+
+	if (m_table)
+	{
+		freeMem(m_table);
+		m_table = nullptr;
+	}
+
+	if (m_slots)
+	{
+		freeMem(m_slots);
+		m_slots = nullptr;
+	}
+
+	if (m_descriptors)
+	{
+		freeMem(m_descriptors);
+		m_descriptors = nullptr;
+	}
+}
+
+DkGpuAddr DescriptorPool::getGpuAddr() const
+{
+	return m_memBlock->getGpuAddrPitch();
+}
+
+uint32_t DescriptorPool::hashDescriptor(Descriptor const& desc)
+{
+	// FNV-1a over the descriptor words
+	uint32_t hash = 2166136261U;
+	for (unsigned i = 0; i < s_descriptorSize/4; i ++)
+	{
+		hash ^= desc.m_words[i];
+		hash *= 16777619U;
+	}
+	return hash ^ (hash >> 16);
+}
+
+uint32_t DescriptorPool::findEntry(Descriptor const& desc, uint32_t hash) const
+{
+	for (uint32_t pos = hash & m_tableMask; m_table[pos]; pos = (pos + 1) & m_tableMask)
+	{
+		uint32_t id = m_table[pos] - 1;
+		if (m_slots[id].m_hash == hash && m_descriptors[id] == desc)
+			return id;
+	}
+	return DK_DESCRIPTOR_INVALID;
+}
+
+void DescriptorPool::removeEntry(uint32_t id)
+{
+	uint32_t pos = m_slots[id].m_hash & m_tableMask;
+	while (m_table[pos] != id + 1)
+		pos = (pos + 1) & m_tableMask;
+
+	// Backward shift deletion: move up any following entry that would
+	// otherwise become unreachable once this position is emptied
+	for (uint32_t next = (pos + 1) & m_tableMask; m_table[next]; next = (next + 1) & m_tableMask)
+	{
+		uint32_t home = m_slots[m_table[next] - 1].m_hash & m_tableMask;
+		if (((next - home) & m_tableMask) >= ((next - pos) & m_tableMask))
+		{
+			m_table[pos] = m_table[next];
+			pos = next;
+		}
+	}
+	m_table[pos] = 0;
+}
+
+uint32_t DescriptorPool::alloc(const void* desc)
+{
+	Descriptor const& d = *static_cast<Descriptor const*>(desc);
+	uint32_t hash = hashDescriptor(d);
+
+	MutexHolder m{m_mutex};
+	uint32_t id = findEntry(d, hash);
+	if (id != DK_DESCRIPTOR_INVALID)
+	{
+		m_slots[id].m_refCount ++;
+		return id;
+	}
+
+	if (m_firstFree >= m_numDescriptors)
+		reclaim();
+	if (m_firstFree >= m_numDescriptors)
+		return DK_DESCRIPTOR_INVALID;
+
+	id = m_firstFree;
+	Slot& slot = m_slots[id];
+	m_firstFree = slot.m_nextFree;
+	slot.m_hash = hash;
+	slot.m_refCount = 1;
+	m_numUsed ++;
+
+	m_descriptors[id] = d;
+	m_gpuDescriptors[id] = d;
+	m_dirty = true;
+
+	uint32_t pos = hash & m_tableMask;
+	while (m_table[pos])
+		pos = (pos + 1) & m_tableMask;
+	m_table[pos] = id + 1;
+
+	return id;
+}
+
+void DescriptorPool::addRef(uint32_t id)
+{
+	MutexHolder m{m_mutex};
+	m_slots[id].m_refCount ++;
+}
+
+bool DescriptorPool::release(uint32_t id)
+{
+	MutexHolder m{m_mutex};
+	Slot& slot = m_slots[id];
+	if (!slot.m_refCount || --slot.m_refCount)
+		return false;
+
+	// The slot only becomes free for reuse after the next commit has made its way through the GPU
+	removeEntry(id);
+	slot.m_nextFree = DK_DESCRIPTOR_INVALID;
+	if (m_releasedLast != DK_DESCRIPTOR_INVALID)
+		m_slots[m_releasedLast].m_nextFree = id;
+	else
+		m_releasedFirst = id;
+	m_releasedLast = id;
+	m_numUsed --;
+	return true;
+}
+
+void DescriptorPool::reclaim()
+{
+	// Must be called with the mutex held. Fences are checked in commit order;
+	// an empty fence means the command list holding it hasn't been submitted yet.
+	while (m_numPending)
+	{
+		PendingFree& p = m_pending[m_pendingStart];
+		if (__atomic_load_n(&p.m_fence.m_type, __ATOMIC_ACQUIRE) == DkFence::Empty || p.m_fence.wait(0) != DkResult_Success)
+			break;
+
+		m_slots[p.m_last].m_nextFree = m_firstFree;
+		m_firstFree = p.m_first;
+		m_pendingStart = (m_pendingStart + 1) % s_maxPendingCommits;
+		m_numPending --;
+	}
+}
+
+void DescriptorPool::commit(DkCmdBuf cmdbuf)
+{
+	// All descriptor writes since the last commit are covered by a single invalidation
+	bool dirty;
+	DkFence* fence = nullptr;
+	{
+		MutexHolder m{m_mutex};
+		dirty = m_dirty;
+		m_dirty = false;
+
+		// Descriptors released so far are handed back once the GPU gets past this point.
+		// If too many commits are already in flight, they wait for a later commit instead.
+		reclaim();
+		if (m_releasedFirst != DK_DESCRIPTOR_INVALID && m_numPending < s_maxPendingCommits)
+		{
+			PendingFree& p = m_pending[(m_pendingStart + m_numPending++) % s_maxPendingCommits];
+			p.m_fence = {};
+			p.m_first = m_releasedFirst;
+			p.m_last = m_releasedLast;
+			m_releasedFirst = m_releasedLast = DK_DESCRIPTOR_INVALID;
+			fence = &p.m_fence;
+		}
+	}
+
+	if (dirty)
+		dkCmdBufBarrier(cmdbuf, DkBarrier_None, DkInvalidateFlags_Descriptors);
+	if (fence)
+		dkCmdBufSignalFence(cmdbuf, fence, false);
+}
+
+DkDescriptorPool dkDescriptorPoolCreate(DkDescriptorPoolMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_ZERO(maker->numDescriptors);
+
+	DkDescriptorPool obj = new(maker->device) DescriptorPool(*maker);
+	DkResult res = obj->initialize();
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkDescriptorPoolDestroy(DkDescriptorPool obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+DkGpuAddr dkDescriptorPoolGetGpuAddr(DkDescriptorPool obj)
+{
+	return obj->getGpuAddr();
+}
+
+uint32_t dkDescriptorPoolGetNumDescriptors(DkDescriptorPool obj)
+{
+	return obj->getNumDescriptors();
+}
+
+uint32_t dkDescriptorPoolAllocImage(DkDescriptorPool obj, DkImageDescriptor const* desc)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(desc);
+	return obj->alloc(desc);
+}
+
+uint32_t dkDescriptorPoolAllocSampler(DkDescriptorPool obj, DkSamplerDescriptor const* desc)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(desc);
+	return obj->alloc(desc);
+}
+
+void dkDescriptorPoolRelease(DkDescriptorPool obj, uint32_t id)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_INPUT(id >= obj->getNumDescriptors(), "descriptor index out of bounds");
+	obj->release(id);
+}
+
+void dkDescriptorPoolCommit(DkDescriptorPool obj, DkCmdBuf cmdbuf)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(cmdbuf);
+	obj->commit(cmdbuf);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_fence.h"
+
+namespace dk::detail
+{
+
+class DescriptorPool : public ObjBase
+{
+public:
+	// Image and sampler descriptors share the same size
+	static constexpr uint32_t s_descriptorSize = 32;
+
+	// Maximum number of commits whose released descriptors can be awaiting the GPU at once
+	static constexpr uint32_t s_maxPendingCommits = 8;
+
+private:
+	struct Descriptor
+	{
+		uint32_t m_words[s_descriptorSize/4];
+
+		bool operator==(Descriptor const& rhs) const noexcept
+		{
+			return memcmp(this, &rhs, sizeof(Descriptor)) == 0;
+		}
+	};
+
+	struct Slot
+	{
+		uint32_t m_hash;
+		uint32_t m_refCount; // zero for free slots
+		uint32_t m_nextFree;
+	};
+
+	// Released descriptors may still be referenced by work in flight, so they are
+	// only reused once a fence signalled by a subsequent commit has passed
+	struct PendingFree
+	{
+		DkFence m_fence;
+		uint32_t m_first; // chain of slots linked through m_nextFree
+		uint32_t m_last;
+	};
+
+	Mutex m_mutex;
+	uint32_t m_numDescriptors;
+	uint32_t m_tableMask;
+	uint32_t m_firstFree;
+	uint32_t m_numUsed;
+	bool m_dirty;
+
+	uint32_t m_releasedFirst; // released since the last commit
+	uint32_t m_releasedLast;
+	uint32_t m_pendingStart;
+	uint32_t m_numPending;
+	PendingFree m_pending[s_maxPendingCommits];
+
+	DkMemBlock m_memBlock;
+	Descriptor* m_gpuDescriptors; // CPU mapping of the descriptors as seen by the GPU
+	Descriptor* m_descriptors;    // CPU side copy, used for lookups
+	Slot* m_slots;
+	uint32_t* m_table; // open addressed hash table of slot indices plus one (zero means empty)
+
+	static uint32_t hashDescriptor(Descriptor const& desc) noexcept;
+
+	uint32_t findEntry(Descriptor const& desc, uint32_t hash) const noexcept;
+	void removeEntry(uint32_t id) noexcept;
+	void reclaim() noexcept;
+
+public:
+	constexpr DescriptorPool(DkDescriptorPoolMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_numDescriptors{m.numDescriptors}, m_tableMask{}, m_firstFree{}, m_numUsed{}, m_dirty{},
+		m_releasedFirst{DK_DESCRIPTOR_INVALID}, m_releasedLast{DK_DESCRIPTOR_INVALID}, m_pendingStart{}, m_numPending{}, m_pending{},
+		m_memBlock{}, m_gpuDescriptors{}, m_descriptors{}, m_slots{}, m_table{} { }
+	~DescriptorPool() { destroy(); }
+
+	DkResult initialize() noexcept;
+	void destroy();
+
+	DkGpuAddr getGpuAddr() const noexcept;
+	constexpr uint32_t getNumDescriptors() const noexcept { return m_numDescriptors; }
+	constexpr uint32_t getNumUsed() const noexcept { return m_numUsed; }
+
+	uint32_t alloc(const void* desc) noexcept;
+	void addRef(uint32_t id) noexcept;
+	bool release(uint32_t id) noexcept; // returns true if the descriptor was freed
+	void commit(DkCmdBuf cmdbuf) noexcept;
+};
+
+}
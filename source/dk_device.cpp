@@ -1,5 +1,7 @@
 #include <stdarg.h>
 #include "dk_device.h"
+#include "layoutcache.h"
+#include "samplercache.h"
 
 using namespace dk::detail;
 
@@ -80,6 +82,9 @@ DkResult Device::initialize()
 {
 	DkResult res;
 
+	// Set up the allocator used for small driver objects
+	m_slab.initialize();
+
 	if (R_FAILED(nvLibInit()))
 		return DkResult_Fail;
 	m_didLibInit = true;
@@ -109,6 +114,25 @@ DkResult Device::initialize()
 	if (res != DkResult_Success)
 		return res;
 
+	// Set up the image layout cache, if requested
+	if (m_maker.flags & DkDeviceFlags_CacheImageLayouts)
+	{
+		m_layoutCache = new(this) ImageLayoutCache(this);
+		if (!m_layoutCache)
+			return DkResult_OutOfMemory;
+	}
+
+	// Set up the sampler cache, if requested
+	if (m_maker.flags & DkDeviceFlags_CacheSamplers)
+	{
+		m_samplerCache = new(this) SamplerCache(this);
+		if (!m_samplerCache)
+			return DkResult_OutOfMemory;
+		res = m_samplerCache->initialize();
+		if (res != DkResult_Success)
+			return res;
+	}
+
 	// TODO: Set up built-in shaders, if we ever decide to have them?
 	// TODO: Get zbc active slot mask
 
@@ -125,17 +149,27 @@ Device::~Device()
 			DK_ERROR(DkResult_BadState, "unfreed queues");
 #endif
 
+	if (m_samplerCache)
+		delete m_samplerCache; // owns a memory block, so it goes along with the others
+
 	m_semaphoreMem.destroy(); // must do this before NvLib is wound down
 	m_codeSeg.cleanup();
+	m_programIds.cleanup();
+
+	if (m_layoutCache)
+		delete m_layoutCache;
 
 #ifdef DEBUG
 	// Ensure there are no outstanding unfreed memory blocks
-	if (m_nvMapCount != 0)
+	if (m_memBlockCount != 0)
 		DK_ERROR(DkResult_BadState, "unfreed memory blocks");
 #endif
 
 	nvAddressSpaceClose(&m_addrSpace); // does nothing if uninitialized
 	nvLibExit();
+
+	// Release slab memory last, as all objects allocated from it are gone by now
+	m_slab.cleanup();
 }
 
 int32_t Device::reserveQueueId()
@@ -161,8 +195,98 @@ void Device::returnQueueId(uint32_t id)
 	m_usedQueues[id/32] &= ~(1U << (id & 0x3F));
 }
 
+void Device::trackMemBlock(MemBlock const& blk, bool add) noexcept
+{
+	uint64_t size = blk.getSize();
+	uint32_t flags = blk.getFlags();
+
+	if (add)
+		__atomic_add_fetch(&m_memBlockCount, 1, __ATOMIC_RELAXED);
+	else
+		__atomic_sub_fetch(&m_memBlockCount, 1, __ATOMIC_RELAXED);
+
+	if (blk.isCpuUncached())
+		trackMemStat(MemStat_CpuUncached, size, add);
+	else if (blk.isCpuCached())
+		trackMemStat(MemStat_CpuCached, size, add);
+
+	if (blk.isGpuUncached())
+		trackMemStat(MemStat_GpuUncached, size, add);
+	else if (blk.isGpuCached())
+		trackMemStat(MemStat_GpuCached, size, add);
+
+	if (blk.isCode())
+		trackMemStat(MemStat_Code, size, add);
+	if (blk.isImage())
+		trackMemStat(MemStat_Image, size, add);
+	if (blk.isOwned())
+		trackMemStat(MemStat_Owned, size, add);
+	if (flags & MemBlockFlags_QueueCmdMem)
+		trackMemStat(MemStat_QueueCmdMem, size, add);
+	if (flags & MemBlockFlags_QueueWorkBuf)
+		trackMemStat(MemStat_QueueWorkBuf, size, add);
+
+	if (!add)
+	{
+		__atomic_sub_fetch(&m_memStats[MemStat_Total], size, __ATOMIC_RELAXED);
+		return;
+	}
+
+	// Notify the user if this allocation made us go over budget
+	uint64_t newTotal = __atomic_add_fetch(&m_memStats[MemStat_Total], size, __ATOMIC_RELAXED);
+	uint64_t budget = __atomic_load_n(&m_memBudget, __ATOMIC_ACQUIRE);
+	if (newTotal > budget && (newTotal - size) <= budget)
+	{
+		// The callback and its user data are read as a pair, but the callback itself
+		// is invoked without the lock (it may well want to adjust the budget)
+		DkMemoryBudgetFunc func;
+		void* userData;
+		{
+			MutexHolder m{m_memBudgetMutex};
+			func = m_memBudgetFunc;
+			userData = m_memBudgetUserData;
+		}
+		if (func)
+			func(userData, const_cast<Device*>(this), newTotal, budget);
+	}
+}
+
+void Device::getMemoryStats(DkMemoryStats& out) const noexcept
+{
+	auto load = [this](MemStat stat) { return __atomic_load_n(&m_memStats[stat], __ATOMIC_RELAXED); };
+	out.numMemBlocks     = __atomic_load_n(&m_memBlockCount, __ATOMIC_RELAXED);
+	out.totalSize        = load(MemStat_Total);
+	out.cpuUncachedSize  = load(MemStat_CpuUncached);
+	out.cpuCachedSize    = load(MemStat_CpuCached);
+	out.gpuUncachedSize  = load(MemStat_GpuUncached);
+	out.gpuCachedSize    = load(MemStat_GpuCached);
+	out.codeSize         = load(MemStat_Code);
+	out.imageSize        = load(MemStat_Image);
+	out.ownedSize        = load(MemStat_Owned);
+	out.codeSegmentSize  = load(MemStat_CodeSegment);
+	out.queueCmdMemSize  = load(MemStat_QueueCmdMem);
+	out.queueWorkBufSize = load(MemStat_QueueWorkBuf);
+}
+
+void Device::setMemoryBudget(uint64_t budget, DkMemoryBudgetFunc func, void* userData) noexcept
+{
+	MutexHolder m{m_memBudgetMutex};
+	m_memBudgetFunc = func;
+	m_memBudgetUserData = userData;
+	__atomic_store_n(&m_memBudget, func ? budget : UINT64_MAX, __ATOMIC_RELEASE);
+}
+
 void* Device::allocMem(size_t size, size_t alignment) const noexcept
 {
+	// Small objects are served from the slab allocator, falling back to
+	// the user allocator for everything else (or if the slab is exhausted)
+	if (SlabAllocator::isSuitable(size, alignment))
+	{
+		void* ptr = m_slab.allocObj(size);
+		if (ptr)
+			return ptr;
+	}
+
 	void* ptr = nullptr;
 	DkResult res = m_maker.cbAlloc(m_maker.userData, alignment, size, &ptr);
 	if (res != DkResult_Success)
@@ -172,7 +296,8 @@ void* Device::allocMem(size_t size, size_t alignment) const noexcept
 
 void Device::freeMem(void* mem) const noexcept
 {
-	m_maker.cbFree(m_maker.userData, mem);
+	if (!m_slab.freeObj(mem))
+		m_maker.cbFree(m_maker.userData, mem);
 }
 
 DkDevice dkDeviceCreate(DkDeviceMaker const* maker)
@@ -267,3 +392,54 @@ uint64_t dkDeviceGetCurrentTimestamp([[maybe_unused]] DkDevice obj) {
 uint64_t dkDeviceGetCurrentTimestampInNs(DkDevice obj) {
 	return dkTimestampToNs(dkDeviceGetCurrentTimestamp(obj));
 }
+
+void dkDeviceGetMemoryStats(DkDevice obj, DkMemoryStats* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(out);
+	obj->getMemoryStats(*out);
+}
+
+void dkDeviceSetMemoryBudget(DkDevice obj, uint64_t budget, DkMemoryBudgetFunc func, void* userData)
+{
+	DK_ENTRYPOINT(obj);
+	obj->setMemoryBudget(budget, func, userData);
+}
+
+void dkDeviceGetSlabStats(DkDevice obj, DkSlabStats* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(out);
+	obj->getSlab().getStats(*out);
+}
+
+DkGpuAddr dkDeviceGetSamplerCacheGpuAddr(DkDevice obj)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_STATE(!obj->getSamplerCache(), "device was not created with DkDeviceFlags_CacheSamplers");
+	return obj->getSamplerCache()->getGpuAddr();
+}
+
+uint32_t dkDeviceAcquireSampler(DkDevice obj, DkSampler const* sampler)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(sampler);
+	DK_DEBUG_BAD_STATE(!obj->getSamplerCache(), "device was not created with DkDeviceFlags_CacheSamplers");
+	return obj->getSamplerCache()->acquire(*sampler);
+}
+
+void dkDeviceReleaseSampler(DkDevice obj, uint32_t id)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_STATE(!obj->getSamplerCache(), "device was not created with DkDeviceFlags_CacheSamplers");
+	DK_DEBUG_BAD_INPUT(id >= SamplerCache::s_numSamplers, "sampler index out of bounds");
+	obj->getSamplerCache()->release(id);
+}
+
+void dkDeviceCommitSamplers(DkDevice obj, DkCmdBuf cmdbuf)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(cmdbuf);
+	DK_DEBUG_BAD_STATE(!obj->getSamplerCache(), "device was not created with DkDeviceFlags_CacheSamplers");
+	obj->getSamplerCache()->commit(cmdbuf);
+}
@@ -2,6 +2,8 @@
 #include "dk_private.h"
 #include "dk_memblock.h"
 #include "codesegmgr.h"
+#include "slaballoc.h"
+#include "programids.h"
 
 #ifdef DEBUG
 #define DK_DEVICE_ERROR(_m, _ctx, _res, _msg) \
@@ -14,6 +16,9 @@
 namespace dk::detail
 {
 
+class ImageLayoutCache;
+class SamplerCache;
+
 #ifdef DEBUG
 
 NX_INLINE void InvokeDebugCallback(DkDeviceMaker const& m, const char* context, DkResult res, const char* message)
@@ -51,19 +56,40 @@ struct ZcullStorageInfo
 	u32 totalSize;
 };
 
+enum MemStat
+{
+	MemStat_Total,
+	MemStat_CpuUncached,
+	MemStat_CpuCached,
+	MemStat_GpuUncached,
+	MemStat_GpuCached,
+	MemStat_Code,
+	MemStat_Image,
+	MemStat_Owned,
+	MemStat_CodeSegment,
+	MemStat_QueueCmdMem,
+	MemStat_QueueWorkBuf,
+
+	MemStat_Count
+};
+
 class Device
 {
 	static constexpr unsigned s_numQueues = DK_MEMBLOCK_ALIGNMENT / sizeof(NvLongSemaphore);
 	static constexpr unsigned s_usedQueueBitmapSize = (s_numQueues + 31) >> 5;
 
 	DkDeviceMaker m_maker;
+	mutable SlabAllocator m_slab;
 	mutable NvAddressSpace m_addrSpace;
 	GpuInfo m_gpuInfo;
 	bool m_didLibInit;
 
-#ifdef DEBUG
-	uint32_t m_nvMapCount;
-#endif
+	uint32_t m_memBlockCount;
+	uint64_t m_memStats[MemStat_Count];
+	uint64_t m_memBudget;
+	mutable Mutex m_memBudgetMutex; // guards the callback and its user data
+	DkMemoryBudgetFunc m_memBudgetFunc;
+	void* m_memBudgetUserData;
 
 	Mutex m_queueTableMutex;
 	DkQueue m_queueTable[s_numQueues];
@@ -73,21 +99,26 @@ class Device
 	uint32_t m_semaphores[s_numQueues];
 
 	CodeSegMgr m_codeSeg;
+	ProgramIdTable m_programIds;
+	ImageLayoutCache* m_layoutCache;
+	SamplerCache* m_samplerCache;
 
 public:
 
 	constexpr Device(DkDeviceMaker const& m) noexcept :
-		m_maker{m}, m_addrSpace{}, m_gpuInfo{}, m_didLibInit{},
-#ifdef DEBUG
-		m_nvMapCount{},
-#endif
+		m_maker{m}, m_slab{this}, m_addrSpace{}, m_gpuInfo{}, m_didLibInit{},
+		m_memBlockCount{}, m_memStats{}, m_memBudget{UINT64_MAX}, m_memBudgetMutex{}, m_memBudgetFunc{}, m_memBudgetUserData{},
 		m_queueTableMutex{}, m_queueTable{}, m_usedQueues{},
 		m_semaphoreMem{this}, m_semaphores{},
-		m_codeSeg{this} { }
+		m_codeSeg{this}, m_programIds{this}, m_layoutCache{}, m_samplerCache{} { }
 	constexpr DkDeviceMaker const& getMaker() const noexcept { return m_maker; }
 	constexpr NvAddressSpace *getAddrSpace() const noexcept { return &m_addrSpace; }
 	constexpr CodeSegMgr &getCodeSeg() noexcept { return m_codeSeg; }
 	constexpr GpuInfo const& getGpuInfo() const noexcept { return m_gpuInfo; }
+	constexpr SlabAllocator &getSlab() noexcept { return m_slab; }
+	constexpr ProgramIdTable &getProgramIds() noexcept { return m_programIds; }
+	constexpr ImageLayoutCache* getLayoutCache() const noexcept { return m_layoutCache; }
+	constexpr SamplerCache* getSamplerCache() const noexcept { return m_samplerCache; }
 
 	bool isDepthModeOpenGL() const noexcept { return (m_maker.flags & DkDeviceFlags_DepthMinusOneToOne) != 0; }
 	bool isOriginLowerLeft() const noexcept { return (m_maker.flags & DkDeviceFlags_OriginLowerLeft) != 0; }
@@ -134,19 +165,17 @@ public:
 	void checkQueueErrors() noexcept;
 	void calcZcullStorageInfo(ZcullStorageInfo& out, uint32_t width, uint32_t height, uint32_t depth, DkImageFormat format, DkMsMode msMode);
 
-	void incrNvMapCount() noexcept
+	void trackMemStat(MemStat stat, uint64_t size, bool add) noexcept
 	{
-#ifdef DEBUG
-		__atomic_add_fetch(&m_nvMapCount, 1, __ATOMIC_SEQ_CST);
-#endif
+		if (add)
+			__atomic_add_fetch(&m_memStats[stat], size, __ATOMIC_RELAXED);
+		else
+			__atomic_sub_fetch(&m_memStats[stat], size, __ATOMIC_RELAXED);
 	}
 
-	void decrNvMapCount() noexcept
-	{
-#ifdef DEBUG
-		__atomic_sub_fetch(&m_nvMapCount, 1, __ATOMIC_SEQ_CST);
-#endif
-	}
+	void trackMemBlock(MemBlock const& blk, bool add) noexcept;
+	void getMemoryStats(DkMemoryStats& out) const noexcept;
+	void setMemoryBudget(uint64_t budget, DkMemoryBudgetFunc func, void* userData) noexcept;
 
 	void* allocMem(size_t size, size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) const noexcept;
 	void freeMem(void* mem) const noexcept;
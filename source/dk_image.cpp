@@ -1,6 +1,7 @@
 #include "dk_image.h"
 #include "dk_device.h"
 #include "dk_memblock.h"
+#include "layoutcache.h"
 #include "cmdbuf_writer.h"
 
 #include "engine_3d.h"
@@ -72,42 +73,73 @@ namespace
 	}
 }
 
-uint64_t DkImageLayout::calcLevelOffset(unsigned level) const
+void DkImageLayout::calcLevelTiling(unsigned level, TiledLevel& out) const
 {
 	uint32_t tileWidth  = 64 / m_bytesPerBlock; // non-sparse tile width is always zero
 	uint32_t tileHeight = 8 << m_tileH;
 	uint32_t tileDepth  = 1 << m_tileD;
 
-	u64 offset = 0;
-	for (unsigned i = 0; i < level; i ++)
+	uint32_t levelWidth  = adjustSize(m_dimensions[0]*m_samplesX, level, m_blockW);
+	uint32_t levelHeight = m_dimsPerLayer>=2 ? adjustSize(m_dimensions[1]*m_samplesY, level, m_blockH) : 1;
+	uint32_t levelDepth  = m_dimsPerLayer>=3 ? adjustMipSize(m_dimensions[2], level) : 1;
+	uint32_t levelWidthBytes = levelWidth << m_bytesPerBlockLog2;
+
+	uint32_t levelTileHShift = adjustTileSize(m_tileH, 8,  levelHeight);
+	uint32_t levelTileDShift = adjustTileSize(m_tileD, 1,  levelDepth);
+	uint32_t levelTileHGobs  = 1U << levelTileHShift;
+	uint32_t levelTileD      = 1U << levelTileDShift;
+
+	uint32_t levelWidthGobs = (levelWidthBytes + 63) / 64;
+	uint32_t levelHeightGobs = (levelHeight + 7) / 8;
+
+	out.m_widthBytes  = levelWidthBytes;
+	out.m_height      = levelHeight;
+	out.m_depth       = levelDepth;
+	out.m_widthTiles  = levelWidthGobs;
+	out.m_heightTiles = (levelHeightGobs + levelTileHGobs - 1) >> levelTileHShift;
+	out.m_depthTiles  = (levelDepth + levelTileD - 1) >> levelTileDShift;
+	out.m_tileHShift  = levelTileHShift;
+	out.m_tileDShift  = levelTileDShift;
+
+	if (m_tileW && tileWidth <= levelWidth && tileHeight <= levelHeight && tileDepth <= levelDepth)
 	{
-		uint32_t levelWidth  = adjustSize(m_dimensions[0]*m_samplesX, i, m_blockW);
-		uint32_t levelHeight = m_dimsPerLayer>=2 ? adjustSize(m_dimensions[1]*m_samplesY, i, m_blockH) : 1;
-		uint32_t levelDepth  = m_dimsPerLayer>=3 ? adjustMipSize(m_dimensions[2], i) : 1;
-		uint32_t levelWidthBytes = levelWidth << m_bytesPerBlockLog2;
-
-		uint32_t levelTileWShift = adjustTileSize(0,       64, levelWidthBytes); // non-sparse tile width is always zero
-		uint32_t levelTileHShift = adjustTileSize(m_tileH, 8,  levelHeight);
-		uint32_t levelTileDShift = adjustTileSize(m_tileD, 1,  levelDepth);
-		uint32_t levelTileWGobs  = 1U << levelTileWShift;
-		uint32_t levelTileHGobs  = 1U << levelTileHShift;
-		uint32_t levelTileD      = 1U << levelTileDShift;
-
-		uint32_t levelWidthGobs = (levelWidthBytes + 63) / 64;
-		uint32_t levelHeightGobs = (levelHeight + 7) / 8;
+		// For sparse images, we need to align the width using the sparse tile width.
+		uint32_t align = 1U << m_tileW;
+		out.m_widthTiles = (out.m_widthTiles + align - 1) &~ (align - 1);
+	}
+}
 
-		uint32_t levelWidthTiles = (levelWidthGobs + levelTileWGobs - 1) >> levelTileWShift;
-		uint32_t levelHeightTiles = (levelHeightGobs + levelTileHGobs - 1) >> levelTileHShift;
-		uint32_t levelDepthTiles = (levelDepth + levelTileD - 1) >> levelTileDShift;
+uint64_t DkImageLayout::calcLevelOffset(unsigned level) const
+{
+	if (!level)
+		return 0;
+
+	// Use the precalculated offsets whenever possible. Levels past the cached
+	// ones are tiny, so only a handful of them need to be walked over.
+	unsigned start = level <= s_numCachedLevels ? level : s_numCachedLevels;
+	u64 offset = u64(m_levelOffsets[start - 1]) << 9;
+	for (unsigned i = start; i < level; i ++)
+	{
+		TiledLevel info;
+		calcLevelTiling(i, info);
+		offset += info.size();
+	}
 
-		if (m_tileW && tileWidth <= levelWidth && tileHeight <= levelHeight && tileDepth <= levelDepth)
-		{
-			// For sparse images, we need to align the width using the sparse tile width.
-			uint32_t align = 1U << m_tileW;
-			levelWidthTiles = (levelWidthTiles + align - 1) &~ (align - 1);
-		}
+	return offset;
+}
 
-		offset += uint64_t(levelWidthTiles*levelHeightTiles*levelDepthTiles) << (9 + levelTileWShift + levelTileHShift + levelTileDShift);
+uint64_t DkImageLayout::initLevelCache()
+{
+	u64 offset = 0;
+	for (unsigned i = 0; i < m_mipLevels; i ++)
+	{
+		TiledLevel info;
+		calcLevelTiling(i, info);
+		if (i && i <= s_numCachedLevels)
+			m_levelTileShifts[i - 1] = info.m_tileHShift | (info.m_tileDShift << 4);
+		offset += info.size();
+		if (i < s_numCachedLevels)
+			m_levelOffsets[i] = offset >> 9;
 	}
 
 	return offset;
@@ -197,9 +229,9 @@ void ImageInfo::fromImageView(DkImageView const* view, unsigned usage)
 		{
 			m_iova += image->calcLevelOffset(view->mipLevelOffset);
 			if (type != DkImageType_3D)
-				tileHShift = adjustTileSize(tileHShift, 8, m_heightMs);
+				tileHShift = image->getLevelTileH(view->mipLevelOffset);
 			else
-				tileDShift = adjustTileSize(tileDShift, 1, m_depth);
+				tileDShift = image->getLevelTileD(view->mipLevelOffset);
 		}
 
 		if (view->layerOffset)
@@ -258,6 +290,10 @@ void dkImageLayoutInitialize(DkImageLayout* obj, DkImageLayoutMaker const* maker
 		"cannot use multisampling mode with non-multisampling image types");
 	DK_DEBUG_BAD_INPUT(!maker->mipLevels, "there needs to be at least one mip level");
 
+	ImageLayoutCache* cache = maker->device->getLayoutCache();
+	if (cache && cache->lookup(*maker, *obj))
+		return;
+
 	memset(obj, 0, sizeof(*obj));
 	obj->m_type = maker->type;
 	obj->m_flags = maker->flags;
@@ -405,6 +441,8 @@ void dkImageLayoutInitialize(DkImageLayout* obj, DkImageLayoutMaker const* maker
 
 	if (obj->m_flags & DkImageFlags_PitchLinear)
 	{
+		DK_DEBUG_BAD_FLAGS(obj->m_flags & DkImageFlags_UsageSparse,
+			"cannot use DkImageFlags_UsageSparse with DkImageFlags_PitchLinear");
 		DK_DEBUG_BAD_INPUT(obj->m_dimsPerLayer != 2 || obj->m_hasLayers,
 			"pitch linear images must be 2D non-layered");
 		DK_DEBUG_BAD_INPUT(obj->m_mipLevels > 1,
@@ -455,30 +493,49 @@ void dkImageLayoutInitialize(DkImageLayout* obj, DkImageLayoutMaker const* maker
 		}
 	}
 
+	const bool isSparse = (obj->m_flags & DkImageFlags_UsageSparse) != 0;
+	const uint32_t bigPageSize = maker->device->getGpuInfo().bigPageSize;
+	if (isSparse)
+	{
+		// Rows of tiles are padded to whole big pages (see calcLevelTiling), so that every
+		// level big enough to hold a full tile starts and ends on the granularity at which
+		// memory can be committed. The smaller levels at the end of the chain share pages.
+		uint32_t pageGobsLog2 = __builtin_ctz(bigPageSize) - 9;
+		uint32_t tileGobsLog2 = obj->m_tileH + obj->m_tileD;
+		obj->m_tileW = tileGobsLog2 < pageGobsLog2 ? pageGobsLog2 - tileGobsLog2 : 0;
+	}
+
 	// Pick a memory kind for this image
 	obj->m_memKind = pickImageMemoryKind(traits, obj->m_numSamplesLog2,
 		(obj->m_flags & DkImageFlags_HwCompression) != 0,
 		(obj->m_flags & DkImageFlags_Z16EnableZbc) != 0);
 
-	obj->m_layerSize = obj->calcLevelOffset(obj->m_mipLevels);
+	obj->m_layerSize = obj->initLevelCache();
 	if (obj->m_hasLayers)
 		obj->m_layerSize = alignLayerSize(obj->m_layerSize, obj->m_dimensions[1], obj->m_dimensions[2], obj->m_blockH, obj->m_tileH, obj->m_tileD);
 
+	if (obj->m_hasLayers && isSparse)
+		obj->m_layerSize = (obj->m_layerSize + bigPageSize - 1) &~ uint64_t(bigPageSize - 1);
+
 	if (obj->m_hasLayers)
 		obj->m_storageSize = obj->m_dimensions[2] * obj->m_layerSize;
 	else
 		obj->m_storageSize = obj->m_layerSize;
 
-	if (obj->m_memKind != NvKind_Pitch && obj->m_memKind != NvKind_Generic_16BX2)
+	if (isSparse || (obj->m_memKind != NvKind_Pitch && obj->m_memKind != NvKind_Generic_16BX2))
 	{
 		// Since we are using a special memory kind, we need to align the image and its size
 		// to a big page boundary so that we can safely reprotect the memory occupied by it.
-		uint32_t bigPageSize = maker->device->getGpuInfo().bigPageSize;
+		// Sparse images are committed in big pages, so they need the same alignment.
 		obj->m_storageSize = (obj->m_storageSize + bigPageSize - 1) &~ (bigPageSize - 1);
 		obj->m_alignment = bigPageSize;
 	}
 	else
 		obj->m_alignment = 512;
+
+	// Only block linear layouts are worth caching, the rest are trivial to calculate
+	if (cache)
+		cache->insert(*maker, *obj);
 }
 
 uint64_t dkImageLayoutGetSize(DkImageLayout const* obj)
@@ -491,6 +548,17 @@ uint32_t dkImageLayoutGetAlignment(DkImageLayout const* obj)
 	return obj->m_alignment;
 }
 
+uint64_t dkImageLayoutGetLevelOffset(DkImageLayout const* obj, uint32_t mipLevel)
+{
+	DK_DEBUG_BAD_INPUT(mipLevel >= obj->m_mipLevels, "mip level out of bounds");
+	return obj->calcLevelOffset(mipLevel);
+}
+
+uint64_t dkImageLayoutGetLayerSize(DkImageLayout const* obj)
+{
+	return obj->m_layerSize;
+}
+
 void dkImageInitialize(DkImage* obj, DkImageLayout const* layout, DkMemBlock memBlock, uint32_t offset)
 {
 	DK_ENTRYPOINT(memBlock);
@@ -508,6 +576,110 @@ DkGpuAddr dkImageGetGpuAddr(DkImage const* obj)
 	return obj->m_iova;
 }
 
+namespace
+{
+	template <bool ToTiled>
+	void transferTexels(DkImage const* obj, uint32_t mipLevel, DkImageRect const* rect, void* data, uint32_t rowLength, uint32_t imageHeight)
+	{
+		DkMemBlock memBlock = obj->m_memBlock;
+		const bool is3D = obj->m_type == DkImageType_3D;
+		DK_DEBUG_NON_NULL(data);
+		DK_DEBUG_BAD_INPUT(memBlock->isCpuNoAccess(), "image must be backed by CPU accessible memory");
+		DK_DEBUG_BAD_INPUT(obj->m_type == DkImageType_Buffer, "buffer images are not supported");
+		DK_DEBUG_BAD_INPUT(obj->m_numSamplesLog2 != DkMsMode_1x, "multisampled images are not supported");
+		DK_DEBUG_BAD_INPUT(mipLevel >= obj->m_mipLevels, "mip level out of bounds");
+		DK_DEBUG_BAD_INPUT(!rect || !rect->width || !rect->height || !rect->depth, "invalid rect");
+		DK_DEBUG_BAD_INPUT(rect->x + rect->width > adjustMipSize(obj->m_dimensions[0], mipLevel), "rect x/width out of bounds");
+		DK_DEBUG_BAD_INPUT(rect->y + rect->height > adjustMipSize(obj->m_dimensions[1], mipLevel), "rect y/height out of bounds");
+		DK_DEBUG_BAD_INPUT(rect->z + rect->depth > (is3D ? adjustMipSize(obj->m_dimensions[2], mipLevel) : obj->m_dimensions[2]), "rect z/depth out of bounds");
+		DK_DEBUG_BAD_INPUT(rect->x % obj->m_blockW || rect->y % obj->m_blockH, "rect must be aligned to the compression block size");
+
+		SwizzleRect r;
+		r.x = rect->x / obj->m_blockW * obj->m_bytesPerBlock;
+		r.y = rect->y / obj->m_blockH;
+		r.z = is3D ? rect->z : 0;
+		r.widthBytes = adjustBlockSize(rect->width, obj->m_blockW) * obj->m_bytesPerBlock;
+		r.height = adjustBlockSize(rect->height, obj->m_blockH);
+		r.depth = is3D ? rect->depth : 1;
+		r.rowPitch = rowLength ? rowLength : r.widthBytes;
+		r.slicePitch = imageHeight ? imageHeight : r.height*r.rowPitch;
+
+		uint8_t* linear = static_cast<uint8_t*>(data);
+		uint8_t* base = static_cast<uint8_t*>(memBlock->getCpuAddr()) + obj->m_memOffset;
+		auto markDirty = [memBlock](uint32_t offset, uint32_t size)
+		{
+			// If the range can't be tracked, flush it straight away instead
+			if constexpr (ToTiled)
+				if (memBlock->markDirty(offset, size) != DkResult_Success)
+					memBlock->flushCpuCache(offset, size);
+		};
+		auto invalidate = [memBlock](uint32_t offset, uint32_t size)
+		{
+			// The GPU may have written the range behind the CPU cache's back. Flushing
+			// also writes back any lines still dirty from earlier CPU writes.
+			if constexpr (!ToTiled)
+				if (memBlock->isCpuCached())
+					memBlock->flushCpuCache(offset, size);
+		};
+
+		if (obj->m_flags & DkImageFlags_PitchLinear)
+		{
+			uint32_t offset = r.y*obj->m_stride + r.x;
+			invalidate(obj->m_memOffset + offset, (r.height-1)*obj->m_stride + r.widthBytes);
+			for (uint32_t y = 0; y < r.height; y ++)
+			{
+				if constexpr (ToTiled)
+					memcpy(base + offset + y*obj->m_stride, linear + y*r.rowPitch, r.widthBytes);
+				else
+					memcpy(linear + y*r.rowPitch, base + offset + y*obj->m_stride, r.widthBytes);
+			}
+			markDirty(obj->m_memOffset + offset, (r.height-1)*obj->m_stride + r.widthBytes);
+			return;
+		}
+
+		TiledLevel level;
+		obj->calcLevelTiling(mipLevel, level);
+		uint64_t levelOffset = obj->calcLevelOffset(mipLevel);
+		uint32_t numLayers = is3D ? 1 : rect->depth;
+		uint64_t rangeOffset, rangeSize;
+		CalcBlockLinearRange(level, r, rangeOffset, rangeSize);
+		for (uint32_t i = 0; i < numLayers; i ++)
+		{
+			uint64_t offset = levelOffset;
+			if (!is3D)
+				offset += (rect->z + i) * obj->m_layerSize;
+
+			invalidate(obj->m_memOffset + offset + rangeOffset, rangeSize);
+			if constexpr (ToTiled)
+				SwizzleToBlockLinear(base + offset, level, linear, r);
+			else
+				DeswizzleFromBlockLinear(linear, level, base + offset, r);
+			markDirty(obj->m_memOffset + offset + rangeOffset, rangeSize);
+			linear += r.slicePitch;
+		}
+	}
+}
+
+void dkImageWriteTexels(DkImage const* obj, uint32_t mipLevel, DkImageRect const* rect, const void* src, uint32_t rowLength, uint32_t imageHeight)
+{
+	// Sparse images (see dkSparseImageInitImage) have no memory block the CPU could access
+	DK_DEBUG_BAD_INPUT(!obj->m_memBlock, "image must be backed by a memory block");
+	if (!obj->m_memBlock)
+		return;
+	DK_ENTRYPOINT(obj->m_memBlock);
+	transferTexels<true>(obj, mipLevel, rect, const_cast<void*>(src), rowLength, imageHeight);
+}
+
+void dkImageReadTexels(DkImage const* obj, uint32_t mipLevel, DkImageRect const* rect, void* dst, uint32_t rowLength, uint32_t imageHeight)
+{
+	// Sparse images (see dkSparseImageInitImage) have no memory block the CPU could access
+	DK_DEBUG_BAD_INPUT(!obj->m_memBlock, "image must be backed by a memory block");
+	if (!obj->m_memBlock)
+		return;
+	DK_ENTRYPOINT(obj->m_memBlock);
+	transferTexels<false>(obj, mipLevel, rect, dst, rowLength, imageHeight);
+}
+
 void dkCmdBufCopyImage(DkCmdBuf obj, DkImageView const* srcView, DkImageRect const* srcRect, DkImageView const* dstView, DkImageRect const* dstRect, uint32_t flags)
 {
 	DK_ENTRYPOINT(obj);
@@ -543,14 +715,10 @@ void dkCmdBufCopyImage(DkCmdBuf obj, DkImageView const* srcView, DkImageRect con
 	params.width = srcRect->width;
 	params.height = srcRect->height;
 
-	for (uint32_t z = 0; z < dstRect->depth; z ++)
-	{
-		uint32_t srcZ = z;
-		uint32_t dstZ = dstRect->z + z;
-		if (flags & DkBlitFlag_FlipZ)
-			srcZ = dstRect->depth - z - 1;
-		BlitCopyEngine(obj, srcInfo, dstInfo, params, srcZ, dstZ);
-	}
+	if (flags & DkBlitFlag_FlipZ)
+		BlitCopyEngine(obj, srcInfo, dstInfo, params, dstRect->depth - 1, dstRect->z, dstRect->depth, -1);
+	else
+		BlitCopyEngine(obj, srcInfo, dstInfo, params, 0, dstRect->z, dstRect->depth);
 }
 
 void dkCmdBufBlitImage(DkCmdBuf obj, DkImageView const* srcView, DkImageRect const* srcRect, DkImageView const* dstView, DkImageRect const* dstRect, uint32_t flags, uint32_t factor)
@@ -694,6 +862,74 @@ void dkCmdBufResolveImage(DkCmdBuf obj, DkImageView const* srcView, DkImageView
 		Blit2D_SetupEngine | Blit2D_UseFilter, 0);
 }
 
+void dkCmdBufGenerateMipmaps(DkCmdBuf obj, DkImage const* image, uint32_t baseLevel, uint32_t levelCount, uint32_t flags)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(image);
+	DK_DEBUG_BAD_INPUT(baseLevel >= image->m_mipLevels, "base mip level out of bounds");
+	DK_DEBUG_BAD_INPUT(baseLevel + levelCount > image->m_mipLevels, "mip level count out of bounds");
+	DK_DEBUG_BAD_INPUT(image->m_blockW > 1 || image->m_blockH > 1, "cannot generate mipmaps for compressed formats");
+
+	// The 2D engine only filters within a slice, so the depth of 3D images can't be downsampled
+	DK_DEBUG_BAD_INPUT(image->m_type == DkImageType_3D, "cannot generate mipmaps for 3D images");
+	if (image->m_type == DkImageType_3D)
+		return;
+
+	uint32_t endLevel = levelCount ? baseLevel + levelCount : image->m_mipLevels;
+	if (endLevel <= baseLevel + 1)
+		return;
+
+	DkImageView srcView, dstView;
+	dkImageViewDefaults(&srcView, image);
+	dkImageViewDefaults(&dstView, image);
+
+	// The engine itself is only set up once; each level just needs its surfaces, and
+	// the layers of a level only differ in their addresses.
+	uint32_t blitFlags = Blit2D_SetupEngine | Blit2D_OriginCorner;
+	if (flags & DkBlitFlag_FilterLinear)
+		blitFlags |= Blit2D_UseFilter;
+
+	for (uint32_t level = baseLevel + 1; level < endLevel; level ++)
+	{
+		srcView.mipLevelOffset = level - 1;
+		dstView.mipLevelOffset = level;
+
+		ImageInfo srcInfo, dstInfo;
+		srcInfo.fromImageView(&srcView, ImageInfo::Transfer2D);
+		dstInfo.fromImageView(&dstView, ImageInfo::Transfer2D);
+
+		if (level > baseLevel + 1)
+		{
+			// The previous level must be fully written before it can be read back
+			CmdBufWriter w{obj};
+			w.reserve(1);
+			w << CmdInline(3D, WaitForIdle{}, 0);
+		}
+
+		BlitParams params;
+		params.dstX = 0;
+		params.dstY = 0;
+		params.width = dstInfo.m_width;
+		params.height = dstInfo.m_height;
+
+		int32_t dudx = (srcInfo.m_width << DiffFractBits) / (int32_t)params.width;
+		int32_t dvdy = (srcInfo.m_height << DiffFractBits) / (int32_t)params.height;
+		params.srcX = dudx >> (DiffFractBits-SrcFractBits+1);
+		params.srcY = dvdy >> (DiffFractBits-SrcFractBits+1);
+
+		uint32_t numLayers = srcInfo.m_isLayered ? srcInfo.m_arrayMode : 1;
+		for (uint32_t layer = 0; layer < numLayers; layer ++)
+		{
+			Blit2DEngine(obj, srcInfo, dstInfo, params, dudx, dvdy, blitFlags, 0);
+			srcInfo.m_iova += srcInfo.m_layerStride;
+			dstInfo.m_iova += dstInfo.m_layerStride;
+			blitFlags &= ~(Blit2D_SetupEngine | Blit2D_SetupSurfaces);
+		}
+
+		blitFlags |= Blit2D_SetupSurfaces;
+	}
+}
+
 void dkCmdBufCopyBufferToImage(DkCmdBuf obj, DkCopyBuf const* src, DkImageView const* dstView, DkImageRect const* dstRect, uint32_t flags)
 {
 	DK_ENTRYPOINT(obj);
@@ -801,14 +1037,59 @@ void dkCmdBufCopyBufferToImage(DkCmdBuf obj, DkCopyBuf const* src, DkImageView c
 			srcInfo.m_horizontal = -srcInfo.m_horizontal;
 		}
 
-		for (uint32_t z = 0; z < dstRect->depth; z ++)
+		if (flags & DkBlitFlag_FlipZ)
+			BlitCopyEngine(obj, srcInfo, dstInfo, params, dstRect->depth - 1, dstRect->z, dstRect->depth, -1);
+		else
+			BlitCopyEngine(obj, srcInfo, dstInfo, params, 0, dstRect->z, dstRect->depth);
+	}
+}
+
+void dkCmdBufCopyBufferToImageMips(DkCmdBuf obj, DkGpuAddr src, DkImage const* dstImage, DkCopyBufRegion const regions[], uint32_t numRegions)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_INPUT(src == DK_GPU_ADDR_INVALID, "invalid src");
+	DK_DEBUG_NON_NULL(dstImage);
+	DK_DEBUG_NON_NULL_ARRAY(regions, numRegions);
+
+	auto& traits = formatTraits[dstImage->m_format];
+	[[maybe_unused]] const bool is3D = dstImage->m_type == DkImageType_3D;
+
+	DkImageView view;
+	dkImageViewDefaults(&view, dstImage);
+
+	ImageInfo dstInfo;
+	CopyDstState state = { DK_GPU_ADDR_INVALID };
+	for (uint32_t i = 0; i < numRegions; i ++)
+	{
+		DkCopyBufRegion const& region = regions[i];
+		DkImageRect const& rect = region.rect;
+		DK_DEBUG_BAD_INPUT(region.mipLevel >= dstImage->m_mipLevels, "mip level out of bounds");
+		DK_DEBUG_BAD_INPUT(!rect.width || !rect.height || !rect.depth, "invalid rect");
+		DK_DEBUG_BAD_INPUT(rect.x + rect.width > adjustMipSize(dstImage->m_dimensions[0], region.mipLevel), "rect x/width out of bounds");
+		DK_DEBUG_BAD_INPUT(rect.y + rect.height > adjustMipSize(dstImage->m_dimensions[1], region.mipLevel), "rect y/height out of bounds");
+		DK_DEBUG_BAD_INPUT(rect.z + rect.depth > (is3D ? adjustMipSize(dstImage->m_dimensions[2], region.mipLevel) : dstImage->m_dimensions[2]), "rect z/depth out of bounds");
+
+		// Regions are expected to be grouped by mip level, so that the
+		// destination only needs to be worked out once per level
+		if (!i || region.mipLevel != view.mipLevelOffset)
 		{
-			uint32_t srcZ = z;
-			uint32_t dstZ = dstRect->z + z;
-			if (flags & DkBlitFlag_FlipZ)
-				srcZ = dstRect->depth - z - 1;
-			BlitCopyEngine(obj, srcInfo, dstInfo, params, srcZ, dstZ);
+			view.mipLevelOffset = region.mipLevel;
+			dstInfo.fromImageView(&view, ImageInfo::TransferCopy);
 		}
+
+		BlitParams params;
+		params.srcX = 0;
+		params.srcY = 0;
+		params.dstX = adjustBlockSize(rect.x, traits.blockWidth);
+		params.dstY = adjustBlockSize(rect.y, traits.blockHeight);
+		params.width = adjustBlockSize(rect.width, traits.blockWidth);
+		params.height = adjustBlockSize(rect.height, traits.blockHeight);
+
+		uint32_t pitch = region.rowLength ? region.rowLength : params.width*dstInfo.m_bytesPerBlock;
+		uint32_t layerStride = region.imageHeight ? region.imageHeight : params.height*pitch;
+		DkGpuAddr srcIova = src + region.offset;
+		for (uint32_t z = 0; z < rect.depth; z ++)
+			CopyEngineBufferToImage(obj, srcIova + z*layerStride, pitch, dstInfo, params, rect.z + z, state);
 	}
 }
 
@@ -919,13 +1200,66 @@ void dkCmdBufCopyImageToBuffer(DkCmdBuf obj, DkImageView const* srcView, DkImage
 			dstInfo.m_horizontal = -dstInfo.m_horizontal;
 		}
 
-		for (uint32_t z = 0; z < srcRect->depth; z ++)
-		{
-			uint32_t srcZ = srcRect->z + z;
-			uint32_t dstZ = z;
-			if (flags & DkBlitFlag_FlipZ)
-				srcZ = srcRect->depth - z - 1;
-			BlitCopyEngine(obj, srcInfo, dstInfo, params, srcZ, dstZ);
-		}
+		if (flags & DkBlitFlag_FlipZ)
+			BlitCopyEngine(obj, srcInfo, dstInfo, params, srcRect->depth - 1, 0, srcRect->depth, -1);
+		else
+			BlitCopyEngine(obj, srcInfo, dstInfo, params, srcRect->z, 0, srcRect->depth);
+	}
+}
+
+void dkCmdBufFillImage(DkCmdBuf obj, DkImageView const* dstView, DkImageRect const* dstRect, const void* value)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(value);
+
+	DkImage const* image = dstView->pImage;
+	auto& traits = formatTraits[dstView->format ? dstView->format : image->m_format];
+	const bool isCompressed = traits.blockWidth > 1 || traits.blockHeight > 1;
+	DK_DEBUG_BAD_INPUT(image->m_numSamplesLog2 != DkMsMode_1x, "multisampled images are not supported");
+
+	// The 2D engine is preferred whenever the image can be used with it, since it
+	// takes care of compressed surfaces. Anything else goes through the copy engine.
+	const bool use2D = !isCompressed && traits.bytesPerBlock <= 4 &&
+		(image->m_flags & DkImageFlags_Usage2DEngine) && (traits.flags & FormatTraitFlags_CanUse2DEngine);
+
+	ImageInfo dstInfo;
+	dstInfo.fromImageView(dstView, use2D ? ImageInfo::Transfer2D : ImageInfo::TransferCopy);
+
+	DK_DEBUG_BAD_INPUT(!dstRect || !dstRect->width || !dstRect->height || !dstRect->depth, "invalid dstRect");
+	// The bounds of the view's mip level are given in (compression) blocks
+	DK_DEBUG_BAD_INPUT(adjustBlockSize(dstRect->x + dstRect->width, traits.blockWidth) > dstInfo.m_width, "dstRect x/width out of bounds");
+	DK_DEBUG_BAD_INPUT(adjustBlockSize(dstRect->y + dstRect->height, traits.blockHeight) > dstInfo.m_height, "dstRect y/height out of bounds");
+	DK_DEBUG_BAD_INPUT(dstRect->z + dstRect->depth > dstInfo.m_arrayMode, "dstRect z/depth out of bounds");
+
+	BlitParams params;
+	params.srcX = 0;
+	params.srcY = 0;
+	params.dstX = dstRect->x;
+	params.dstY = dstRect->y;
+	params.width = dstRect->width;
+	params.height = dstRect->height;
+
+	if (isCompressed)
+	{
+		DK_DEBUG_BAD_INPUT(dstRect->x % traits.blockWidth || dstRect->y % traits.blockHeight, "dstRect must be aligned to the compression block size");
+		params.dstX = adjustBlockSize(params.dstX, traits.blockWidth);
+		params.dstY = adjustBlockSize(params.dstY, traits.blockHeight);
+		params.width = adjustBlockSize(params.width, traits.blockWidth);
+		params.height = adjustBlockSize(params.height, traits.blockHeight);
+	}
+
+	if (!use2D)
+	{
+		FillCopyEngine(obj, dstInfo, params, dstRect->z, dstRect->depth, value);
+		return;
+	}
+
+	if (dstRect->z)
+		dstInfo.m_iova += dstRect->z * dstInfo.m_layerStride;
+
+	for (uint32_t z = 0; z < dstRect->depth; z ++)
+	{
+		Fill2DEngine(obj, dstInfo, params, value, z == 0);
+		dstInfo.m_iova += dstInfo.m_layerStride;
 	}
 }
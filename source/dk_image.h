@@ -1,5 +1,6 @@
 #pragma once
 #include "dk_private.h"
+#include "swizzle.h"
 
 #include "maxwell/image_formats.h"
 
@@ -28,7 +29,33 @@ struct ImageLayout
 	uint32_t m_alignment;
 	uint32_t m_stride; // {for pitch-linear only}
 
+	// {for block-linear only} Precalculated information about the first few mip levels (starting at level 1):
+	// offsets (in units of GOBs, i.e. 512 bytes) and tile shifts (height in the low nibble, depth in the high one)
+	static constexpr unsigned s_numCachedLevels = 8;
+	uint32_t m_levelOffsets[s_numCachedLevels];
+	uint8_t m_levelTileShifts[s_numCachedLevels];
+
+	void calcLevelTiling(unsigned level, TiledLevel& out) const;
 	uint64_t calcLevelOffset(unsigned level) const;
+	uint64_t initLevelCache();
+
+	unsigned getLevelTileH(unsigned level) const
+	{
+		if (level - 1 < s_numCachedLevels)
+			return m_levelTileShifts[level - 1] & 0xf;
+		TiledLevel info;
+		calcLevelTiling(level, info);
+		return info.m_tileHShift;
+	}
+
+	unsigned getLevelTileD(unsigned level) const
+	{
+		if (level - 1 < s_numCachedLevels)
+			return m_levelTileShifts[level - 1] >> 4;
+		TiledLevel info;
+		calcLevelTiling(level, info);
+		return info.m_tileDShift;
+	}
 };
 
 struct Image : public ImageLayout
@@ -95,9 +122,10 @@ namespace dk::detail
 
 	enum
 	{
-		Blit2D_SetupEngine  = 1U << 0,
-		Blit2D_OriginCorner = 1U << 1,
-		Blit2D_UseFilter    = 1U << 2,
+		Blit2D_SetupEngine   = 1U << 0,
+		Blit2D_OriginCorner  = 1U << 1,
+		Blit2D_UseFilter     = 1U << 2,
+		Blit2D_SetupSurfaces = 1U << 3, // reprograms the surfaces only, implied by Blit2D_SetupEngine
 	};
 
 	struct BlitParams
@@ -114,6 +142,31 @@ namespace dk::detail
 	constexpr unsigned DiffFractBits = 15;
 	constexpr unsigned SrcFractBits = 4;
 
-	void BlitCopyEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo const& dst, BlitParams const& params, uint32_t srcZ, uint32_t dstZ);
+	// Copies depth slices starting at srcZ/dstZ; the source slice advances by srcZStep each time (-1 for flipped copies)
+	void BlitCopyEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo const& dst, BlitParams const& params, uint32_t srcZ, uint32_t dstZ, uint32_t depth = 1, int32_t srcZStep = 1);
+
+	// Copy engine limits respected by BlitCopyEngine: block linear surfaces wider than
+	// CopyMaxLineLength bytes are copied through the remapping unit, and large transfers
+	// are split in pieces so that the engine can interleave other work.
+	constexpr uint32_t CopyMaxLineLength  = 0x10000;
+	constexpr uint32_t CopyMaxPieceSize   = 0x400000;
+
+	// Destination state last programmed by CopyEngineBufferToImage, used to avoid
+	// re-emitting the whole copy engine setup for every region of a batched upload.
+	struct CopyDstState
+	{
+		DkGpuAddr m_iova;
+		uint32_t m_layer;
+		uint32_t m_origin;
+	};
+
+	void CopyEngineBufferToImage(DkCmdBuf obj, DkGpuAddr srcIova, uint32_t srcPitch, ImageInfo const& dst, BlitParams const& params, uint32_t dstZ, CopyDstState& state);
 	void Blit2DEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo const& dst, BlitParams const& params, int32_t dudx, int32_t dvdy, uint32_t flags, uint32_t factor);
+
+	// Fills the dst rectangle of depth slices starting at dstZ with a texel value (m_bytesPerBlock bytes),
+	// using the copy engine's remapping unit as a constant source
+	void FillCopyEngine(DkCmdBuf obj, ImageInfo const& dst, BlitParams const& params, uint32_t dstZ, uint32_t depth, const void* value);
+
+	// Fills the dst rectangle with a texel value (m_bytesPerBlock bytes, at most 4) using the 2D engine
+	void Fill2DEngine(DkCmdBuf obj, ImageInfo const& dst, BlitParams const& params, const void* value, bool setup);
 }
@@ -3,6 +3,22 @@
 
 using namespace dk::detail;
 
+namespace
+{
+	int compareMemRanges(const void* a, const void* b)
+	{
+		auto& lhs = *static_cast<DkMemRange const*>(a);
+		auto& rhs = *static_cast<DkMemRange const*>(b);
+		uintptr_t lhsBlk = reinterpret_cast<uintptr_t>(lhs.memBlock);
+		uintptr_t rhsBlk = reinterpret_cast<uintptr_t>(rhs.memBlock);
+		if (lhsBlk != rhsBlk)
+			return lhsBlk < rhsBlk ? -1 : 1;
+		if (lhs.offset != rhs.offset)
+			return lhs.offset < rhs.offset ? -1 : 1;
+		return 0;
+	}
+}
+
 DkResult MemBlock::initialize(uint32_t flags, void* storage, uint32_t size)
 {
 	// Extract CPU/GPU access bits
@@ -56,7 +72,7 @@ DkResult MemBlock::initialize(uint32_t flags, void* storage, uint32_t size)
 	if (R_FAILED(nvMapCreate(&m_mapObj, storage, size, bigPageSize, NvKind_Pitch, isCpuCached())))
 		return DkResult_Fail;
 
-	getDevice()->incrNvMapCount();
+	getDevice()->trackMemBlock(*this, true);
 
 	// Map the block into the GPU address space, if the GPU is to have access to this memory block
 	if (!isGpuNoAccess())
@@ -130,8 +146,14 @@ void MemBlock::destroy()
 
 	if (m_mapObj.has_init)
 	{
+		getDevice()->trackMemBlock(*this, false);
 		nvMapClose(&m_mapObj);
-		getDevice()->decrNvMapCount();
+	}
+
+	if (m_dirtyRanges)
+	{
+		freeMem(m_dirtyRanges);
+		m_dirtyRanges = nullptr;
 	}
 
 	if (m_ownedMem)
@@ -153,6 +175,40 @@ DkGpuAddr MemBlock::getGpuAddrForImage(uint32_t offset, uint32_t size, NvKind ki
 	return m_gpuAddrCompressed + offset;
 }
 
+void MemBlock::flushCpuCache(uint32_t offset, uint32_t size) noexcept
+{
+	// Ranges coming from the dirty tracker are rounded up to whole cache lines
+	if (offset + size > getSize())
+		size = getSize() - offset;
+	if (size)
+		armDCacheFlush((uint8_t*)getCpuAddr() + offset, size);
+}
+
+DkResult MemBlock::markDirty(uint32_t offset, uint32_t size) noexcept
+{
+	if (!isCpuCached() || !size)
+		return DkResult_Success;
+
+	MutexHolder m{m_dirtyMutex};
+	if (!m_dirtyRanges)
+	{
+		void* mem = allocMem(sizeof(DirtyRangeTracker));
+		if (!mem)
+			return DkResult_OutOfMemory;
+		m_dirtyRanges = new(mem) DirtyRangeTracker;
+	}
+
+	m_dirtyRanges->add(offset, offset + size);
+	return DkResult_Success;
+}
+
+void MemBlock::flushDirty() noexcept
+{
+	MutexHolder m{m_dirtyMutex};
+	if (m_dirtyRanges)
+		m_dirtyRanges->flush([this](uint32_t offset, uint32_t size) { flushCpuCache(offset, size); });
+}
+
 DkMemBlock dkMemBlockCreate(DkMemBlockMaker const* maker)
 {
 	DK_ENTRYPOINT(maker->device);
@@ -160,7 +216,7 @@ DkMemBlock dkMemBlockCreate(DkMemBlockMaker const* maker)
 	DK_DEBUG_DATA_ALIGN(maker->storage, DK_MEMBLOCK_ALIGNMENT);
 
 	DkMemBlock obj = new(maker->device) MemBlock(maker->device);
-	DkResult res = obj->initialize(maker->flags, maker->storage, maker->size);
+	DkResult res = obj->initialize(maker->flags &~ MemBlockFlags_InternalMask, maker->storage, maker->size);
 	if (res != DkResult_Success)
 	{
 		delete obj;
@@ -201,3 +257,71 @@ DkResult dkMemBlockFlushCpuCache(DkMemBlock obj, uint32_t offset, uint32_t size)
 
 	return DkResult_Success;
 }
+
+void dkMemBlockMarkDirty(DkMemBlock obj, uint32_t offset, uint32_t size)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_INPUT(offset >= obj->getSize() || size > obj->getSize() || offset + size > obj->getSize(), "memory range out of bounds");
+
+	DkResult res = obj->markDirty(offset, size);
+	if (res != DkResult_Success)
+		DK_ERROR(res, "failed to track dirty range");
+}
+
+DkResult dkMemBlockFlushDirty(DkMemBlock obj)
+{
+	DK_ENTRYPOINT(obj);
+	obj->flushDirty();
+	return DkResult_Success;
+}
+
+DkResult dkMemBlockFlushCpuCacheRanges(DkMemRange const ranges[], uint32_t numRanges)
+{
+	DK_DEBUG_NON_NULL_ARRAY(ranges, numRanges);
+	if (!numRanges)
+		return DkResult_Success;
+	DK_ENTRYPOINT(ranges[0].memBlock);
+
+	for (uint32_t i = 0; i < numRanges; i ++)
+	{
+		[[maybe_unused]] DkMemRange const& range = ranges[i];
+		DK_DEBUG_NON_NULL(range.memBlock);
+		DK_DEBUG_BAD_INPUT(range.offset >= range.memBlock->getSize() || range.size > range.memBlock->getSize() || range.offset + range.size > range.memBlock->getSize(), "memory range out of bounds");
+	}
+
+	// Sort a local copy by block and offset, so that overlapping or adjacent ranges
+	// can be merged. Only the given ranges are flushed: the blocks' dirty trackers
+	// (which may hold unrelated ranges) are left alone. If there is no memory for
+	// the copy, the ranges are simply flushed one by one.
+	DkMemRange* sorted = static_cast<DkMemRange*>(ranges[0].memBlock->allocMem(numRanges*sizeof(DkMemRange)));
+	if (!sorted)
+	{
+		for (uint32_t i = 0; i < numRanges; i ++)
+			if (ranges[i].memBlock->isCpuCached())
+				ranges[i].memBlock->flushCpuCache(ranges[i].offset, ranges[i].size);
+		return DkResult_Success;
+	}
+
+	memcpy(sorted, ranges, numRanges*sizeof(DkMemRange));
+	qsort(sorted, numRanges, sizeof(DkMemRange), compareMemRanges);
+
+	DkMemRange cur = sorted[0];
+	for (uint32_t i = 1; i <= numRanges; i ++)
+	{
+		if (i < numRanges && sorted[i].memBlock == cur.memBlock && sorted[i].offset <= cur.offset + cur.size)
+		{
+			uint32_t end = sorted[i].offset + sorted[i].size;
+			if (end > cur.offset + cur.size)
+				cur.size = end - cur.offset;
+			continue;
+		}
+
+		if (cur.memBlock->isCpuCached())
+			cur.memBlock->flushCpuCache(cur.offset, cur.size);
+		if (i < numRanges)
+			cur = sorted[i];
+	}
+
+	ranges[0].memBlock->freeMem(sorted);
+	return DkResult_Success;
+}
@@ -1,15 +1,26 @@
 #pragma once
 #include "dk_private.h"
+#include "dirtyranges.h"
 
 namespace dk::detail
 {
 
+// Internal flags used to tag memory blocks allocated by the driver for its own use
+enum
+{
+	MemBlockFlags_QueueCmdMem  = 1U << 30,
+	MemBlockFlags_QueueWorkBuf = 1U << 31,
+	MemBlockFlags_InternalMask = MemBlockFlags_QueueCmdMem | MemBlockFlags_QueueWorkBuf,
+};
+
 class MemBlock : public ObjBase
 {
 	mutable NvMap m_mapObj;
 	uint32_t m_flags;
 	uint32_t m_codeSegOffset;
 	void* m_ownedMem;
+	Mutex m_dirtyMutex;
+	DirtyRangeTracker* m_dirtyRanges;
 	DkGpuAddr m_gpuAddrPitch;
 	DkGpuAddr m_gpuAddrGeneric;
 	DkGpuAddr m_gpuAddrCompressed;
@@ -17,6 +28,7 @@ class MemBlock : public ObjBase
 public:
 	constexpr MemBlock(DkDevice dev) noexcept : ObjBase{dev},
 		m_mapObj{}, m_flags{}, m_codeSegOffset{}, m_ownedMem{},
+		m_dirtyMutex{}, m_dirtyRanges{},
 		m_gpuAddrPitch{DK_GPU_ADDR_INVALID},
 		m_gpuAddrGeneric{DK_GPU_ADDR_INVALID},
 		m_gpuAddrCompressed{DK_GPU_ADDR_INVALID} { }
@@ -36,6 +48,8 @@ public:
 	constexpr bool isGpuCached() const noexcept { return getGpuAccess() == DkMemAccess_Cached; }
 	constexpr bool isCode() const noexcept { return (m_flags & DkMemBlockFlags_Code) != 0; }
 	constexpr bool isImage() const noexcept { return (m_flags & DkMemBlockFlags_Image) != 0; }
+	constexpr bool isOwned() const noexcept { return m_ownedMem != nullptr; }
+	constexpr uint32_t getFlags() const noexcept { return m_flags; }
 
 	uint32_t getHandle() const noexcept { return nvMapGetHandle(&m_mapObj); }
 	uint32_t getId() const noexcept { return nvMapGetId(&m_mapObj); }
@@ -46,6 +60,10 @@ public:
 	DkGpuAddr getGpuAddrGeneric() const noexcept { return m_gpuAddrGeneric; }
 	DkGpuAddr getGpuAddrCompressed() const noexcept { return m_gpuAddrCompressed; }
 	DkGpuAddr getGpuAddrForImage(uint32_t offset, uint32_t size, NvKind kind) noexcept;
+
+	void flushCpuCache(uint32_t offset, uint32_t size) noexcept;
+	DkResult markDirty(uint32_t offset, uint32_t size) noexcept;
+	void flushDirty() noexcept;
 };
 
 }
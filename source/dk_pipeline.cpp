@@ -0,0 +1,144 @@
+#include "dk_pipeline.h"
+#include "dk_device.h"
+#include "cmdbuf_writer.h"
+
+using namespace dk::detail;
+
+DkResult Pipeline::initialize(DkPipelineMaker const& m)
+{
+	uint32_t* scratch = static_cast<uint32_t*>(allocMem(s_maxWords*sizeof(uint32_t)));
+	if (!scratch)
+		return DkResult_OutOfMemory;
+
+	// Each state group is recorded through the regular bind functions into a
+	// throwaway command buffer, so that the encoding can never diverge from
+	// what binding the same state piecemeal would produce.
+	DkCmdBufMaker cmdMaker;
+	dkCmdBufMakerDefaults(&cmdMaker, getDevice());
+	CmdBuf cmdbuf{cmdMaker};
+	uint32_t pos = 0;
+
+	auto capture = [&](Section section, auto&& bindFunc)
+	{
+		cmdbuf.beginCapture(&scratch[pos], s_maxWords - pos);
+		bindFunc(&cmdbuf);
+		uint32_t size = cmdbuf.endCapture();
+		m_sections[section] = { uint16_t(pos), uint16_t(size) };
+		pos += size;
+	};
+
+	if (m.numShaders)
+		capture(Section_Shaders, [&](DkCmdBuf cb) { dkCmdBufBindShaders(cb, m.stageMask, m.shaders, m.numShaders); });
+	if (m.rasterizerState)
+		capture(Section_Rasterizer, [&](DkCmdBuf cb) { dkCmdBufBindRasterizerState(cb, m.rasterizerState); });
+	if (m.multisampleState)
+		capture(Section_Multisample, [&](DkCmdBuf cb) { dkCmdBufBindMultisampleState(cb, m.multisampleState); });
+	if (m.colorState)
+		capture(Section_Color, [&](DkCmdBuf cb) { dkCmdBufBindColorState(cb, m.colorState); });
+	if (m.colorWriteState)
+		capture(Section_ColorWrite, [&](DkCmdBuf cb) { dkCmdBufBindColorWriteState(cb, m.colorWriteState); });
+	if (m.numBlendStates)
+		capture(Section_Blend, [&](DkCmdBuf cb) { dkCmdBufBindBlendStates(cb, 0, m.blendStates, m.numBlendStates); });
+	if (m.depthStencilState)
+		capture(Section_DepthStencil, [&](DkCmdBuf cb) { dkCmdBufBindDepthStencilState(cb, m.depthStencilState); });
+	capture(Section_VtxAttrib, [&](DkCmdBuf cb) { dkCmdBufBindVtxAttribState(cb, m.vtxAttribs, m.numVtxAttribs); });
+	capture(Section_VtxBuffer, [&](DkCmdBuf cb) { dkCmdBufBindVtxBufferState(cb, m.vtxBuffers, m.numVtxBuffers); });
+
+	for (unsigned i = 0; i < 6; i ++)
+		m_programIds[i] = cmdbuf.getBoundProgramId(i);
+
+	m_words = static_cast<uint32_t*>(allocMem(pos*sizeof(uint32_t)));
+	if (m_words)
+	{
+		memcpy(m_words, scratch, pos*sizeof(uint32_t));
+		m_numWords = pos;
+	}
+
+	freeMem(scratch);
+	return m_words ? DkResult_Success : DkResult_OutOfMemory;
+}
+
+void Pipeline::destroy()
+{
+	if (m_words)
+	{
+		freeMem(m_words);
+		m_words = nullptr;
+	}
+}
+
+void Pipeline::bind(DkCmdBuf cmdbuf, Pipeline const* prev) const
+{
+	// Sections that encode to the exact same words as in the previous pipeline
+	// are already in effect, and are left out. Sections absent from this
+	// pipeline are never emitted (whatever was bound before stays in place).
+	uint32_t emitMask = 0, numWords = 0;
+	for (unsigned i = 0; i < Section_Count; i ++)
+	{
+		SectionInfo const& cur = m_sections[i];
+		if (!cur.m_size)
+			continue;
+		if (prev)
+		{
+			SectionInfo const& old = prev->m_sections[i];
+			if (old.m_size == cur.m_size &&
+				memcmp(&prev->m_words[old.m_offset], &m_words[cur.m_offset], cur.m_size*sizeof(uint32_t)) == 0)
+				continue;
+		}
+		emitMask |= 1U << i;
+		numWords += cur.m_size;
+	}
+
+	if (!emitMask)
+		return;
+
+	CmdBufWriter w{cmdbuf};
+	w.reserve(numWords);
+	for (unsigned i = 0; i < Section_Count; i ++)
+		if (emitMask & (1U << i))
+			w.addRawData(&m_words[m_sections[i].m_offset], m_sections[i].m_size*sizeof(uint32_t));
+
+	if (emitMask & (1U << Section_Shaders))
+		for (unsigned i = 0; i < 6; i ++)
+			if (m_programIds[i])
+				cmdbuf->trackProgramBind(i, m_programIds[i]);
+}
+
+DkPipeline dkPipelineCreate(DkPipelineMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_BAD_FLAGS(maker->stageMask &~ DkStageFlag_GraphicsMask, "pipelines may only contain graphics stages");
+	DK_DEBUG_NON_NULL_ARRAY(maker->shaders, maker->numShaders);
+	DK_DEBUG_NON_NULL_ARRAY(maker->blendStates, maker->numBlendStates);
+	DK_DEBUG_NON_NULL_ARRAY(maker->vtxAttribs, maker->numVtxAttribs);
+	DK_DEBUG_NON_NULL_ARRAY(maker->vtxBuffers, maker->numVtxBuffers);
+
+	DkPipeline obj = new(maker->device) Pipeline(maker->device);
+	DkResult res = obj->initialize(*maker);
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkPipelineDestroy(DkPipeline obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+uint32_t dkPipelineGetNumWords(DkPipeline obj)
+{
+	DK_ENTRYPOINT(obj);
+	return obj->getNumWords();
+}
+
+void dkCmdBufBindPipeline(DkCmdBuf obj, DkPipeline pipeline, DkPipeline prev)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(pipeline);
+	pipeline->bind(obj, prev);
+}
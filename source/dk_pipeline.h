@@ -0,0 +1,54 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+
+class Pipeline : public ObjBase
+{
+public:
+	enum Section
+	{
+		Section_Shaders,
+		Section_Rasterizer,
+		Section_Multisample,
+		Section_Color,
+		Section_ColorWrite,
+		Section_Blend,
+		Section_DepthStencil,
+		Section_VtxAttrib,
+		Section_VtxBuffer,
+
+		Section_Count,
+	};
+
+	// Upper bound for the size of all sections put together. Comfortably above
+	// the sum of what the individual bind functions reserve in the worst case.
+	static constexpr uint32_t s_maxWords = 1024;
+
+private:
+	struct SectionInfo
+	{
+		uint16_t m_offset;
+		uint16_t m_size;
+	};
+
+	SectionInfo m_sections[Section_Count];
+	uint32_t m_numWords;
+	uint32_t m_programIds[6]; // as seen by CmdBuf::trackProgramBind, 0 if not bound
+	uint32_t* m_words;
+
+public:
+	constexpr Pipeline(DkDevice device) noexcept : ObjBase{device},
+		m_sections{}, m_numWords{}, m_programIds{}, m_words{} { }
+	~Pipeline() { destroy(); }
+
+	DkResult initialize(DkPipelineMaker const& m) noexcept;
+	void destroy();
+
+	constexpr uint32_t getNumWords() const noexcept { return m_numWords; }
+
+	void bind(DkCmdBuf cmdbuf, Pipeline const* prev) const noexcept;
+};
+
+}
@@ -29,7 +29,7 @@ DkResult Queue::initialize()
 		return DkResult_Fail;
 
 	// Allocate cmdbuf
-	res = m_cmdBufMemBlock.initialize(DkMemBlockFlags_CpuUncached | DkMemBlockFlags_GpuUncached, nullptr, m_cmdBufRing.getSize());
+	res = m_cmdBufMemBlock.initialize(DkMemBlockFlags_CpuUncached | DkMemBlockFlags_GpuUncached | MemBlockFlags_QueueCmdMem, nullptr, m_cmdBufRing.getSize());
 	if (res != DkResult_Success)
 		return res;
 
@@ -230,7 +230,6 @@ void Queue::signalFence(DkFence& fence, bool flush)
 	printf("  signalFence %p %d\n", &fence, flush);
 #endif
 
-	fence.m_type = DkFence::Internal;
 	fence.m_internal.m_semaphoreAddr = getDevice()->getSemaphoreGpuAddr(m_id);
 	fence.m_internal.m_semaphoreCpuAddr = &getDevice()->getSemaphoreCpuAddr(m_id)->sequence;
 	fence.m_internal.m_device = getDevice();
@@ -270,6 +269,10 @@ void Queue::signalFence(DkFence& fence, bool flush)
 		fence.m_internal.m_semaphoreValue = getDevice()->getSemaphoreValue(m_id);
 
 	nvGpuChannelGetFence(&m_gpuChannel, &fence.m_internal.m_fence);
+
+	// The type is published last, so that anyone observing an Internal fence
+	// (e.g. readbacks being polled from another thread) sees it fully filled in
+	__atomic_store_n(&fence.m_type, DkFence::Internal, __ATOMIC_RELEASE);
 }
 
 void Queue::submitCommands(DkCmdList list)
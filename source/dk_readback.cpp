@@ -0,0 +1,266 @@
+#include "dk_readback.h"
+#include "dk_device.h"
+#include "dk_memblock.h"
+#include "dk_image.h"
+
+using namespace dk::detail;
+using namespace maxwell;
+
+DkResult ReadbackManager::initialize()
+{
+	m_slots = static_cast<Slot*>(allocMem(m_maxReadbacks*sizeof(Slot)));
+	if (!m_slots)
+		return DkResult_OutOfMemory;
+	memset(m_slots, 0, m_maxReadbacks*sizeof(Slot));
+
+	// Staging memory is CPU cached, since it is only ever read on the CPU side
+	m_staging = new(getDevice()) MemBlock(getDevice());
+	DkResult res = m_staging->initialize(DkMemBlockFlags_CpuCached | DkMemBlockFlags_GpuCached, nullptr, m_stagingSize);
+	if (res != DkResult_Success)
+	{
+		delete m_staging;
+		m_staging = nullptr;
+	}
+	return res;
+}
+
+void ReadbackManager::destroy()
+{
+	if (m_staging)
+	{
+		delete m_staging;
+		m_staging = nullptr;
+	}
+
+	if (m_slots)
+	{
+		freeMem(m_slots);
+		m_slots = nullptr;
+	}
+}
+
+DkResult ReadbackManager::alloc(uint32_t size, DkReadback& out, DkGpuAddr& outAddr, DkFence*& outFence)
+{
+	uint32_t allocSize = (size + s_stagingAlign - 1) &~ (s_stagingAlign - 1);
+
+	MutexHolder m{m_mutex};
+	if (m_numSlots == m_maxReadbacks)
+		return DkResult_OutOfMemory;
+
+	uint32_t offset = 0;
+	if (m_numSlots)
+	{
+		uint32_t begin = m_slots[m_firstSlot].m_offset;
+		uint32_t end = m_slots[(m_firstSlot + m_numSlots - 1) % m_maxReadbacks].m_end;
+		if (begin < end)
+		{
+			// Free space is [end, stagingSize) followed by [0, begin)
+			if (end + allocSize <= m_stagingSize)
+				offset = end;
+			else if (allocSize > begin)
+				return DkResult_OutOfMemory;
+		}
+		else
+		{
+			// Already wrapped around: free space is [end, begin)
+			if (end + allocSize > begin)
+				return DkResult_OutOfMemory;
+			offset = end;
+		}
+	}
+	else if (allocSize > m_stagingSize)
+		return DkResult_OutOfMemory;
+
+	uint32_t id = (m_firstSlot + m_numSlots) % m_maxReadbacks;
+	Slot& slot = m_slots[id];
+	slot = {};
+	slot.m_serial = m_nextSerial++;
+	slot.m_offset = offset;
+	slot.m_end = offset + allocSize;
+	slot.m_size = size;
+	m_numSlots ++;
+
+	out.slot = id;
+	out.serial = slot.m_serial;
+	outAddr = m_staging->getGpuAddrPitch() + offset;
+	outFence = &slot.m_fence;
+	return DkResult_Success;
+}
+
+bool ReadbackManager::isReady(DkReadback const& rb)
+{
+	DkFence fence;
+	{
+		MutexHolder m{m_mutex};
+		Slot* slot = getSlot(rb);
+		if (!slot || !isSubmitted(*slot))
+			return false;
+		fence = slot->m_fence;
+	}
+	return fence.wait(0) == DkResult_Success;
+}
+
+DkResult ReadbackManager::wait(DkReadback const& rb, int64_t timeout_ns)
+{
+	DkFence fence;
+	{
+		MutexHolder m{m_mutex};
+		Slot* slot = getSlot(rb);
+		if (!slot)
+			return DkResult_BadInput;
+		if (!isSubmitted(*slot))
+			return DkResult_BadState; // waiting would never finish
+		fence = slot->m_fence;
+	}
+
+	// The fence is waited on without holding the lock, so that other
+	// readbacks can be recorded (or consumed) in the meantime
+	s32 timeout_us = -1;
+	if (timeout_ns >= 0)
+		timeout_us = timeout_ns / 1000;
+	return fence.wait(timeout_us);
+}
+
+const void* ReadbackManager::getData(DkReadback const& rb, uint32_t* size)
+{
+	if (!isReady(rb))
+		return nullptr;
+
+	MutexHolder m{m_mutex};
+	Slot* slot = getSlot(rb);
+	if (!slot)
+		return nullptr;
+
+	// Drop any stale lines left in the CPU cache before the data is read for the first time
+	if (!slot->m_invalidated)
+	{
+		m_staging->flushCpuCache(slot->m_offset, slot->m_end - slot->m_offset);
+		slot->m_invalidated = true;
+	}
+
+	if (size)
+		*size = slot->m_size;
+	return static_cast<uint8_t*>(m_staging->getCpuAddr()) + slot->m_offset;
+}
+
+bool ReadbackManager::release(DkReadback const& rb)
+{
+	MutexHolder m{m_mutex};
+	Slot* slot = getSlot(rb);
+	if (!slot)
+		return true;
+
+	// The queue writes the fence when the command list gets submitted, which
+	// would clobber whichever readback reuses the slot in the meantime
+	if (!isSubmitted(*slot))
+		return false;
+
+	// Staging space is reclaimed in order, as soon as the oldest readbacks are released
+	slot->m_released = true;
+	while (m_numSlots && m_slots[m_firstSlot].m_released)
+	{
+		m_firstSlot = (m_firstSlot + 1) % m_maxReadbacks;
+		m_numSlots --;
+	}
+	return true;
+}
+
+DkReadbackManager dkReadbackManagerCreate(DkReadbackManagerMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_ZERO(maker->stagingSize);
+	DK_DEBUG_SIZE_ALIGN(maker->stagingSize, DK_MEMBLOCK_ALIGNMENT);
+	DK_DEBUG_NON_ZERO(maker->maxReadbacks);
+
+	DkReadbackManager obj = new(maker->device) ReadbackManager(*maker);
+	DkResult res = obj->initialize();
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkReadbackManagerDestroy(DkReadbackManager obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+DkResult dkReadbackManagerReadBuffer(DkReadbackManager obj, DkCmdBuf cmdbuf, DkGpuAddr srcAddr, uint32_t size, DkReadback* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(cmdbuf);
+	DK_DEBUG_BAD_INPUT(srcAddr == DK_GPU_ADDR_INVALID, "invalid source address");
+	DK_DEBUG_NON_ZERO(size);
+	DK_DEBUG_NON_NULL(out);
+
+	DkGpuAddr stagingAddr;
+	DkFence* fence;
+	DkResult res = obj->alloc(size, *out, stagingAddr, fence);
+	if (res != DkResult_Success)
+		return res;
+
+	dkCmdBufCopyBuffer(cmdbuf, srcAddr, stagingAddr, size);
+	dkCmdBufSignalFence(cmdbuf, fence, true);
+	return DkResult_Success;
+}
+
+DkResult dkReadbackManagerReadImage(DkReadbackManager obj, DkCmdBuf cmdbuf, DkImageView const* srcView, DkImageRect const* srcRect, uint32_t flags, DkReadback* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(cmdbuf);
+	DK_DEBUG_NON_NULL(srcView);
+	DK_DEBUG_BAD_INPUT(!srcRect || !srcRect->width || !srcRect->height || !srcRect->depth, "invalid srcRect");
+	DK_DEBUG_NON_NULL(out);
+
+	// The data is tightly packed, just like dkCmdBufCopyImageToBuffer does by default
+	auto& traits = formatTraits[srcView->format ? srcView->format : srcView->pImage->m_format];
+	uint32_t rowSize = (srcRect->width + traits.blockWidth - 1) / traits.blockWidth * traits.bytesPerBlock;
+	uint32_t numRows = (srcRect->height + traits.blockHeight - 1) / traits.blockHeight;
+	uint64_t size = uint64_t(rowSize) * numRows * srcRect->depth;
+	if (size > UINT32_MAX)
+		return DkResult_OutOfMemory;
+
+	DkGpuAddr stagingAddr;
+	DkFence* fence;
+	DkResult res = obj->alloc(size, *out, stagingAddr, fence);
+	if (res != DkResult_Success)
+		return res;
+
+	DkCopyBuf dst = { stagingAddr, 0, 0 };
+	dkCmdBufCopyImageToBuffer(cmdbuf, srcView, srcRect, &dst, flags);
+	dkCmdBufSignalFence(cmdbuf, fence, true);
+	return DkResult_Success;
+}
+
+bool dkReadbackManagerIsReady(DkReadbackManager obj, DkReadback const* readback)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(readback);
+	return obj->isReady(*readback);
+}
+
+DkResult dkReadbackManagerWait(DkReadbackManager obj, DkReadback const* readback, int64_t timeout_ns)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(readback);
+	return obj->wait(*readback, timeout_ns);
+}
+
+const void* dkReadbackManagerGetData(DkReadbackManager obj, DkReadback const* readback, uint32_t* size)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(readback);
+	return obj->getData(*readback, size);
+}
+
+void dkReadbackManagerRelease(DkReadbackManager obj, DkReadback const* readback)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(readback);
+	[[maybe_unused]] bool released = obj->release(*readback);
+	DK_DEBUG_BAD_STATE(!released, "readback must be submitted before it can be released");
+}
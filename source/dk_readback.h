@@ -0,0 +1,67 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_fence.h"
+
+namespace dk::detail
+{
+
+class ReadbackManager : public ObjBase
+{
+	// Every staging allocation is aligned to this, which keeps them usable as
+	// destinations for 2D engine transfers as well as the copy engine.
+	static constexpr uint32_t s_stagingAlign = 0x100;
+
+	struct Slot
+	{
+		DkFence m_fence;
+		uint32_t m_serial;
+		uint32_t m_offset;
+		uint32_t m_end;
+		uint32_t m_size;
+		bool m_released;
+		bool m_invalidated;
+	};
+
+	Mutex m_mutex;
+	uint32_t m_stagingSize;
+	uint32_t m_maxReadbacks;
+	DkMemBlock m_staging;
+	Slot* m_slots;
+
+	// Live slots form a ring (oldest first), and so do their staging allocations
+	uint32_t m_firstSlot;
+	uint32_t m_numSlots;
+	uint32_t m_nextSerial;
+
+	Slot* getSlot(DkReadback const& rb) noexcept
+	{
+		if (rb.slot >= m_maxReadbacks)
+			return nullptr;
+		Slot* slot = &m_slots[rb.slot];
+		return slot->m_serial == rb.serial && !slot->m_released ? slot : nullptr;
+	}
+
+	static bool isSubmitted(Slot const& slot) noexcept
+	{
+		// The queue fills in the fence once the command list is submitted,
+		// publishing its type last (see Queue::signalFence)
+		return __atomic_load_n(&slot.m_fence.m_type, __ATOMIC_ACQUIRE) != DkFence::Empty;
+	}
+
+public:
+	constexpr ReadbackManager(DkReadbackManagerMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_stagingSize{m.stagingSize}, m_maxReadbacks{m.maxReadbacks}, m_staging{}, m_slots{},
+		m_firstSlot{}, m_numSlots{}, m_nextSerial{1} { }
+	~ReadbackManager() { destroy(); }
+
+	DkResult initialize() noexcept;
+	void destroy();
+
+	DkResult alloc(uint32_t size, DkReadback& out, DkGpuAddr& outAddr, DkFence*& outFence) noexcept;
+	bool isReady(DkReadback const& rb) noexcept;
+	DkResult wait(DkReadback const& rb, int64_t timeout_ns) noexcept;
+	const void* getData(DkReadback const& rb, uint32_t* size) noexcept;
+	bool release(DkReadback const& rb) noexcept;
+};
+
+}
@@ -1,3 +1,4 @@
+#include <unistd.h>
 #include "dk_shader.h"
 #include "dk_device.h"
 #include "dk_memblock.h"
@@ -6,21 +7,6 @@ using namespace dk::detail;
 
 namespace
 {
-	uint32_t programId;
-
-	uint32_t getNewProgramId()
-	{
-		uint32_t newId;
-		uint32_t curId = __atomic_load_n(&programId, __ATOMIC_SEQ_CST);
-		do
-		{
-			newId = curId + 1;
-			if (newId == 0)
-				newId = 1; // roll over and skip 0
-		} while (!__atomic_compare_exchange_n(&programId, &curId, newId, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
-		return newId;
-	}
-
 	constexpr DkStage DkshProgramTypeToDkStage(uint32_t id)
 	{
 		switch (id)
@@ -36,10 +22,136 @@ namespace
 	}
 }
 
+bool dk::detail::ReadFully(int fd, void* buf, uint32_t size)
+{
+	u8* pos = (u8*)buf;
+	while (size)
+	{
+		ssize_t got = read(fd, pos, size);
+		if (got <= 0)
+			return false;
+		pos += got;
+		size -= got;
+	}
+	return true;
+}
+
+DkResult dk::detail::CheckDkshHeader(DkshHeader const& hdr)
+{
+	if (hdr.magic != DKSH_MAGIC || hdr.control_sz < sizeof(DkshHeader))
+		return DkResult_BadInput;
+	if ((hdr.control_sz | hdr.code_sz) & (DK_SHADER_CODE_ALIGNMENT - 1))
+		return DkResult_MisalignedSize;
+	if (hdr.programs_off > hdr.control_sz
+		|| hdr.num_programs > (hdr.control_sz - hdr.programs_off) / sizeof(DkshProgramHeader))
+		return DkResult_BadInput;
+	return DkResult_Success;
+}
+
+void dk::detail::InitShader(DkShader* obj, DkMemBlock blk, DkshProgramHeader const& progHdr, uint32_t codeBaseOffset)
+{
+	memset(obj, 0, sizeof(*obj));
+
+	// Initialize the DkShader struct
+	obj->m_magic = DKSH_MAGIC;
+	obj->m_stage = DkshProgramTypeToDkStage(progHdr.type);
+	obj->m_hdr   = progHdr;
+	obj->m_cbuf1IovaShift8 = (blk->getGpuAddrPitch() + uint32_t(codeBaseOffset + obj->m_hdr.constbuf1_off)) >> 8;
+
+	// Fix up code/data offsets (note that codeBaseOffset wraps around when the
+	// code section was placed piecewise, hence the 32-bit sum above)
+	codeBaseOffset += blk->getCodeSegOffset();
+	obj->m_hdr.entrypoint    += codeBaseOffset;
+	obj->m_hdr.constbuf1_off += codeBaseOffset;
+
+	// Identical programs at the same place share the same ID (see programids.h)
+	ProgramIdTable::Key key = {};
+	key.m_stage          = obj->m_stage;
+	key.m_entrypoint     = obj->m_hdr.entrypoint;
+	key.m_numGprs        = obj->m_hdr.num_gprs;
+	key.m_cbufSize       = obj->m_hdr.constbuf1_sz;
+	key.m_cbufIovaShift8 = obj->m_cbuf1IovaShift8;
+	if (obj->m_stage == DkStage_Vertex)
+	{
+		key.m_altEntrypoint = obj->m_hdr.vert.alt_entrypoint;
+		key.m_altNumGprs    = obj->m_hdr.vert.alt_num_gprs;
+	}
+	obj->m_id = blk->getDevice()->getProgramIds().getId(key);
+
+#ifdef DK_SHADER_DEBUG
+	printf("ID:    0x%08x\n", obj->m_id);
+	printf("Stage: %u\n",     obj->m_stage);
+	printf("Entry: 0x%08x\n", obj->m_hdr.entrypoint);
+	printf("CB1:   0x%08x\n", obj->m_hdr.constbuf1_off);
+	printf("CB1sz: 0x%x\n",   obj->m_hdr.constbuf1_sz);
+	printf("GPR:   %u\n",     obj->m_hdr.num_gprs);
+#endif
+}
+
+DkResult DkshModule::open(ObjBase const& owner)
+{
+	if (m_source)
+	{
+		if (m_sourceSize < sizeof(DkshHeader))
+			return DkResult_BadInput;
+		m_hdr = static_cast<DkshHeader const*>(m_source);
+	}
+	else
+	{
+		DkshHeader hdr;
+		if (!ReadFully(m_fd, &hdr, sizeof(hdr)))
+			return DkResult_Fail;
+		if (hdr.magic != DKSH_MAGIC || hdr.control_sz < sizeof(hdr))
+			return DkResult_BadInput;
+
+		m_controlBuf = owner.allocMem(hdr.control_sz);
+		if (!m_controlBuf)
+			return DkResult_OutOfMemory;
+
+		memcpy(m_controlBuf, &hdr, sizeof(hdr));
+		if (!ReadFully(m_fd, (u8*)m_controlBuf + sizeof(hdr), hdr.control_sz - sizeof(hdr)))
+			return DkResult_Fail;
+		m_hdr = static_cast<DkshHeader const*>(m_controlBuf);
+	}
+
+	DkResult res = CheckDkshHeader(*m_hdr);
+	if (res == DkResult_Success && m_source && !CheckDkshSize(*m_hdr, m_sourceSize))
+		res = DkResult_BadInput;
+	return res;
+}
+
+void DkshModule::close(ObjBase const& owner)
+{
+	if (m_controlBuf)
+	{
+		owner.freeMem(m_controlBuf);
+		m_controlBuf = nullptr;
+	}
+	m_hdr = nullptr;
+}
+
+bool DkshModule::readCode(void* dst) const
+{
+	if (m_source)
+	{
+		memcpy(dst, (u8 const*)m_hdr + m_hdr->control_sz, m_hdr->code_sz);
+		return true;
+	}
+	return ReadFully(m_fd, dst, m_hdr->code_sz);
+}
+
+uint32_t DkshModule::initShaders(DkShader shaders[], uint32_t maxShaders, DkMemBlock blk, uint32_t codeBaseOffset) const
+{
+	auto* progTable = (DkshProgramHeader const*)((u8 const*)m_hdr + m_hdr->programs_off);
+	uint32_t count = m_hdr->num_programs < maxShaders ? m_hdr->num_programs : maxShaders;
+	for (uint32_t i = 0; i < count; i ++)
+		InitShader(&shaders[i], blk, progTable[i], codeBaseOffset);
+	return m_hdr->num_programs;
+}
+
 void dkShaderInitialize(DkShader* obj, DkShaderMaker const* maker)
 {
 	DK_ENTRYPOINT(maker->codeMem);
-	memset(obj, 0, sizeof(*obj));
 
 	// Validate memory block
 	DkMemBlock blk = maker->codeMem;
@@ -69,28 +181,67 @@ void dkShaderInitialize(DkShader* obj, DkShaderMaker const* maker)
 
 	// Find the address to the program header
 	auto* progTable = (DkshProgramHeader*)((u8*)phdr + phdr->programs_off);
-	auto& progHdr = progTable[maker->programId];
+	InitShader(obj, blk, progTable[maker->programId], codeBaseOffset);
+}
 
-	// Initialize the DkShader struct
-	obj->m_magic = DKSH_MAGIC;
-	obj->m_stage = DkshProgramTypeToDkStage(progHdr.type);
-	obj->m_id    = getNewProgramId();
-	obj->m_hdr   = progHdr;
-	obj->m_cbuf1IovaShift8 = (blk->getGpuAddrPitch() + codeBaseOffset + obj->m_hdr.constbuf1_off) >> 8;
+DkResult dkShaderModuleLoad(DkShaderModuleMaker const* maker, DkShader shaders[], uint32_t maxShaders, uint32_t* numShaders)
+{
+	DK_ENTRYPOINT(maker->codeMem);
+	DK_DEBUG_NON_NULL_ARRAY(shaders, maxShaders);
 
-	// Fix up code/data offsets
-	codeBaseOffset += blk->getCodeSegOffset();
-	obj->m_hdr.entrypoint    += codeBaseOffset;
-	obj->m_hdr.constbuf1_off += codeBaseOffset;
+	// Validate memory block
+	DkMemBlock blk = maker->codeMem;
+	DK_DEBUG_BAD_FLAGS(!blk->isCode(), "DkMemBlock must be created with DkMemBlockFlags_Code");
+	DK_DEBUG_DATA_ALIGN(maker->codeOffset, DK_SHADER_CODE_ALIGNMENT);
 
-#ifdef DK_SHADER_DEBUG
-	printf("ID:    0x%08x\n", obj->m_id);
-	printf("Stage: %u\n",     obj->m_stage);
-	printf("Entry: 0x%08x\n", obj->m_hdr.entrypoint);
-	printf("CB1:   0x%08x\n", obj->m_hdr.constbuf1_off);
-	printf("CB1sz: 0x%x\n",   obj->m_hdr.constbuf1_sz);
-	printf("GPR:   %u\n",     obj->m_hdr.num_gprs);
-#endif
+	u8* codeMem = (u8*)blk->getCpuAddr();
+	uint32_t codeBaseOffset = maker->codeOffset;
+	uint32_t usableSize = blk->getSize() - DK_SHADER_CODE_UNUSABLE_SIZE;
+	if (codeBaseOffset > usableSize)
+		return DkResult_BadInput;
+
+	// Find (or read in) the control section, and validate it once for the whole module
+	DkshModule mod = { maker->source, maker->sourceSize, maker->fd, nullptr, nullptr };
+	bool inPlace = false;
+	if (maker->source)
+	{
+		// A module that already sits in code memory at the requested offset doesn't need copying
+		inPlace = maker->source == codeMem + codeBaseOffset;
+	}
+	else if (maker->fd < 0)
+	{
+		mod.m_source = codeMem + codeBaseOffset;
+		mod.m_sourceSize = usableSize - codeBaseOffset;
+		inPlace = true;
+	}
+
+	DkResult res = mod.open(*blk);
+	if (res == DkResult_Success && inPlace)
+	{
+		if (mod.m_hdr->control_sz > usableSize - codeBaseOffset)
+			res = DkResult_BadInput;
+		else
+			codeBaseOffset += mod.m_hdr->control_sz;
+	}
+
+	// Ensure the code section doesn't extend into the memory block's unusable area
+	if (res == DkResult_Success && mod.m_hdr->code_sz > usableSize - codeBaseOffset)
+		res = DkResult_BadInput;
+
+	// Place the code section into code memory
+	if (res == DkResult_Success && !inPlace && !mod.readCode(codeMem + codeBaseOffset))
+		res = DkResult_Fail;
+
+	// Initialize all programs in one go
+	if (res == DkResult_Success)
+	{
+		uint32_t count = mod.initShaders(shaders, maxShaders, blk, codeBaseOffset);
+		if (numShaders)
+			*numShaders = count;
+	}
+
+	mod.close(*blk);
+	return res;
 }
 
 bool dkShaderIsValid(DkShader const* obj)
@@ -15,6 +15,39 @@ struct Shader
 	DkshProgramHeader m_hdr;
 };
 
+bool ReadFully(int fd, void* buf, uint32_t size);
+DkResult CheckDkshHeader(DkshHeader const& hdr);
+
+// Whether both sections of a module fit within size bytes (without overflowing)
+constexpr bool CheckDkshSize(DkshHeader const& hdr, uint32_t size)
+{
+	return hdr.control_sz <= size && hdr.code_sz <= size - hdr.control_sz;
+}
+
+// codeBaseOffset is the offset of the start of the module's code section within blk
+void InitShader(DkShader* obj, DkMemBlock blk, DkshProgramHeader const& progHdr, uint32_t codeBaseOffset);
+
+// A DKSH module given either in memory, or read sequentially from a file descriptor
+struct DkshModule
+{
+	const void* m_source; // NULL: read from m_fd
+	uint32_t m_sourceSize;
+	int m_fd;
+	DkshHeader const* m_hdr;
+	void* m_controlBuf; // control section read from m_fd, allocated from the owner
+
+	// Finds (or reads in) the control section and validates it. close() must be called
+	// afterwards regardless of the result.
+	DkResult open(ObjBase const& owner) noexcept;
+	void close(ObjBase const& owner) noexcept;
+
+	// Copies (or reads in) the code section to dst
+	bool readCode(void* dst) const noexcept;
+
+	// Initializes up to maxShaders shaders, returning the number of programs in the module
+	uint32_t initShaders(DkShader shaders[], uint32_t maxShaders, DkMemBlock blk, uint32_t codeBaseOffset) const noexcept;
+};
+
 }
 
 DK_OPAQUE_CHECK(Shader);
@@ -0,0 +1,330 @@
+#include <unistd.h>
+#include "dk_shader_archive.h"
+#include "dk_shader.h"
+#include "dk_device.h"
+
+using namespace dk::detail;
+
+namespace
+{
+	uint64_t hashName(const char* name)
+	{
+		uint64_t hash = UINT64_C(14695981039346656037);
+		for (; *name; name ++)
+		{
+			hash ^= uint8_t(*name);
+			hash *= UINT64_C(1099511628211);
+		}
+		return hash;
+	}
+
+	bool readLength(u8 const*& src, u8 const* srcEnd, uint32_t& len)
+	{
+		uint32_t b;
+		do
+		{
+			if (src >= srcEnd)
+				return false;
+			b = *src++;
+			len += b;
+		} while (b == 255);
+		return true;
+	}
+
+	bool decompressLz4(u8* dst, uint32_t dstSize, u8 const* src, uint32_t srcSize)
+	{
+		u8 const* srcEnd = src + srcSize;
+		u8* out = dst;
+		u8* outEnd = dst + dstSize;
+		while (src < srcEnd)
+		{
+			uint32_t token = *src++;
+
+			// Literals
+			uint32_t len = token >> 4;
+			if (len == 15 && !readLength(src, srcEnd, len))
+				return false;
+			if (len > uint32_t(srcEnd - src) || len > uint32_t(outEnd - out))
+				return false;
+			memcpy(out, src, len);
+			out += len;
+			src += len;
+
+			// The last sequence only contains literals
+			if (src == srcEnd)
+				break;
+
+			// Match (which may overlap the output being produced, hence the bytewise copy)
+			if (srcEnd - src < 2)
+				return false;
+			uint32_t offset = src[0] | (src[1] << 8);
+			src += 2;
+			len = token & 15;
+			if (len == 15 && !readLength(src, srcEnd, len))
+				return false;
+			len += 4;
+			if (!offset || offset > uint32_t(out - dst) || len > uint32_t(outEnd - out))
+				return false;
+			for (u8 const* match = out - offset; len; len --)
+				*out++ = *match++;
+		}
+		return out == outEnd;
+	}
+}
+
+bool ShaderArchive::readAt(uint32_t offset, void* buf, uint32_t size)
+{
+	if (m_data)
+	{
+		if (offset > m_dataSize || size > m_dataSize - offset)
+			return false;
+		memcpy(buf, m_data + offset, size);
+		return true;
+	}
+
+	return lseek(m_fd, offset, SEEK_SET) == off_t(offset) && ReadFully(m_fd, buf, size);
+}
+
+DkResult ShaderArchive::initialize()
+{
+	// Only the index is read upfront, modules are loaded when first used
+	DkshaHeader hdr;
+	if (!readAt(0, &hdr, sizeof(hdr)))
+		return DkResult_Fail;
+	if (hdr.magic != DKSHA_MAGIC || hdr.header_sz < sizeof(hdr) || hdr.num_entries > UINT32_MAX / sizeof(DkshaEntry))
+		return DkResult_BadInput;
+
+	m_numEntries = hdr.num_entries;
+	m_namesSize = hdr.names_sz;
+	uint32_t indexSize = m_numEntries*sizeof(DkshaEntry);
+	if (m_data)
+	{
+		if (hdr.entries_off > m_dataSize || indexSize > m_dataSize - hdr.entries_off || (hdr.entries_off & 7))
+			return DkResult_BadInput;
+		if (hdr.names_off > m_dataSize || m_namesSize > m_dataSize - hdr.names_off)
+			return DkResult_BadInput;
+		m_entries = reinterpret_cast<DkshaEntry const*>(m_data + hdr.entries_off);
+		m_names = reinterpret_cast<const char*>(m_data + hdr.names_off);
+	}
+	else
+	{
+		// The index and the name table are kept in a single allocation
+		if (m_namesSize > UINT32_MAX - indexSize)
+			return DkResult_BadInput;
+		m_entriesBuf = static_cast<DkshaEntry*>(allocMem(indexSize + m_namesSize ? indexSize + m_namesSize : 1));
+		if (!m_entriesBuf)
+			return DkResult_OutOfMemory;
+		char* names = reinterpret_cast<char*>(m_entriesBuf) + indexSize;
+		if (!readAt(hdr.entries_off, m_entriesBuf, indexSize) || !readAt(hdr.names_off, names, m_namesSize))
+			return DkResult_Fail;
+		m_entries = m_entriesBuf;
+		m_names = names;
+	}
+
+	m_modules = static_cast<Module*>(allocMem(m_numEntries ? m_numEntries*sizeof(Module) : 1));
+	if (!m_modules)
+		return DkResult_OutOfMemory;
+	memset(m_modules, 0, m_numEntries*sizeof(Module));
+
+	DkShaderArenaMaker arenaMaker;
+	dkShaderArenaMakerDefaults(&arenaMaker, getDevice());
+	arenaMaker.blockSize = m_blockSize;
+	m_arena = new(getDevice()) ShaderArena(arenaMaker);
+	if (!m_arena)
+		return DkResult_OutOfMemory;
+
+	return DkResult_Success;
+}
+
+void ShaderArchive::destroy()
+{
+	if (m_arena)
+	{
+		delete m_arena;
+		m_arena = nullptr;
+	}
+
+	if (m_modules)
+	{
+		for (uint32_t i = 0; i < m_numEntries; i ++)
+			if (m_modules[i].m_shaders)
+				freeMem(m_modules[i].m_shaders);
+		freeMem(m_modules);
+		m_modules = nullptr;
+	}
+
+	if (m_entriesBuf)
+	{
+		freeMem(m_entriesBuf);
+		m_entriesBuf = nullptr;
+	}
+}
+
+uint32_t ShaderArchive::findModule(const char* name) const
+{
+	size_t nameSize = strlen(name);
+	uint64_t hash = hashName(name);
+	uint32_t lo = 0, hi = m_numEntries;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (m_entries[mid].name_hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// Hashes are not trusted blindly: the name itself must match too
+	// (and there may be several modules sharing the same hash)
+	for (; lo < m_numEntries && m_entries[lo].name_hash == hash; lo ++)
+	{
+		DkshaEntry const& entry = m_entries[lo];
+		if (entry.name_sz == nameSize && entry.name_off <= m_namesSize && entry.name_sz <= m_namesSize - entry.name_off &&
+			memcmp(m_names + entry.name_off, name, nameSize) == 0)
+			return lo;
+	}
+	return DK_SHADER_MODULE_INVALID;
+}
+
+DkResult ShaderArchive::materialize(uint32_t id)
+{
+	// Must be called with the mutex held
+	DkshaEntry const& entry = m_entries[id];
+	if (entry.control_sz < sizeof(DkshHeader) || (entry.code_off & (DK_SHADER_CODE_ALIGNMENT - 1)))
+		return DkResult_BadInput;
+	if (entry.compression == DkshaCompression_None ? entry.stored_code_sz != entry.code_sz : entry.compression != DkshaCompression_Lz4)
+		return DkResult_BadInput;
+
+	// Scratch memory holds the control section, plus the compressed and
+	// decompressed code when needed
+	bool compressed = entry.compression != DkshaCompression_None;
+	uint64_t scratchSize = entry.control_sz;
+	if (compressed)
+		scratchSize += uint64_t(entry.code_sz) + entry.stored_code_sz;
+	if (scratchSize > UINT32_MAX)
+		return DkResult_BadInput;
+	u8* scratch = static_cast<u8*>(allocMem(scratchSize));
+	if (!scratch)
+		return DkResult_OutOfMemory;
+
+	DkshHeader const& hdr = *reinterpret_cast<DkshHeader const*>(scratch);
+	DkResult res = readAt(entry.control_off, scratch, entry.control_sz) ? CheckDkshHeader(hdr) : DkResult_Fail;
+	// The DKSH header must describe exactly what the entry says was read, otherwise
+	// the program table (whose bounds CheckDkshHeader validates against the header's
+	// own control_sz) could lie outside of the scratch buffer
+	if (res == DkResult_Success && (hdr.control_sz != entry.control_sz || hdr.code_sz != entry.code_sz))
+		res = DkResult_BadInput;
+
+	DkShaderCode code = {};
+	if (res == DkResult_Success)
+		res = m_arena->alloc(entry.code_sz, nullptr, code);
+
+	if (res == DkResult_Success)
+	{
+		u8* codeMem = (u8*)code.codeMem->getCpuAddr() + code.codeOffset;
+		if (!compressed)
+		{
+			// Straight into code memory
+			if (!readAt(entry.code_off, codeMem, entry.code_sz))
+				res = DkResult_Fail;
+		}
+		else
+		{
+			// Code memory is uncached, so decompress elsewhere (matches read back the output)
+			u8* decompressed = scratch + entry.control_sz;
+			u8* stored = decompressed + entry.code_sz;
+			if (!readAt(entry.code_off, stored, entry.stored_code_sz))
+				res = DkResult_Fail;
+			else if (!decompressLz4(decompressed, entry.code_sz, stored, entry.stored_code_sz))
+				res = DkResult_BadInput;
+			else
+				memcpy(codeMem, decompressed, entry.code_sz);
+		}
+	}
+
+	Module& mod = m_modules[id];
+	if (res == DkResult_Success)
+	{
+		mod.m_numShaders = hdr.num_programs;
+		mod.m_shaders = static_cast<DkShader*>(allocMem((hdr.num_programs ? hdr.num_programs : 1)*sizeof(DkShader)));
+		if (!mod.m_shaders)
+			res = DkResult_OutOfMemory;
+	}
+
+	if (res == DkResult_Success)
+	{
+		auto* progTable = (DkshProgramHeader const*)(scratch + hdr.programs_off);
+		for (uint32_t i = 0; i < hdr.num_programs; i ++)
+			InitShader(&mod.m_shaders[i], code.codeMem, progTable[i], code.codeOffset);
+	}
+	else
+	{
+		if (code.codeMem)
+			m_arena->free(code);
+		mod.m_numShaders = 0;
+	}
+
+	freeMem(scratch);
+	return res;
+}
+
+DkResult ShaderArchive::getShader(uint32_t id, uint32_t programId, DkShader const*& out)
+{
+	MutexHolder m{m_mutex};
+	Module& mod = m_modules[id];
+
+	// Broken modules are not retried every time they are requested
+	if (!mod.m_shaders && mod.m_error == DkResult_Success)
+		mod.m_error = materialize(id);
+	if (mod.m_error != DkResult_Success)
+		return mod.m_error;
+	if (programId >= mod.m_numShaders)
+		return DkResult_BadInput;
+
+	out = &mod.m_shaders[programId];
+	return DkResult_Success;
+}
+
+DkShaderArchive dkShaderArchiveCreate(DkShaderArchiveMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_BAD_INPUT(!maker->data && maker->fd < 0, "either data or fd must be provided");
+	DK_DEBUG_NON_ZERO(maker->blockSize);
+	DK_DEBUG_SIZE_ALIGN(maker->blockSize, maker->device->getGpuInfo().bigPageSize);
+
+	DkShaderArchive obj = new(maker->device) ShaderArchive(*maker);
+	DkResult res = obj->initialize();
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkShaderArchiveDestroy(DkShaderArchive obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+uint32_t dkShaderArchiveGetNumModules(DkShaderArchive obj)
+{
+	return obj->getNumModules();
+}
+
+uint32_t dkShaderArchiveFindModule(DkShaderArchive obj, const char* name)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(name);
+	return obj->findModule(name);
+}
+
+DkResult dkShaderArchiveGetShader(DkShaderArchive obj, uint32_t moduleId, uint32_t programId, DkShader const** out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_INPUT(moduleId >= obj->getNumModules(), "moduleId out of bounds");
+	DK_DEBUG_NON_NULL(out);
+	return obj->getShader(moduleId, programId, *out);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_shader_arena.h"
+#include "dksha.h"
+
+namespace dk::detail
+{
+
+class ShaderArchive : public ObjBase
+{
+	struct Module
+	{
+		DkShader* m_shaders; // null until the module is first used
+		uint32_t m_numShaders;
+		DkResult m_error; // set when the module could not be loaded
+	};
+
+	Mutex m_mutex;
+	const uint8_t* m_data;
+	uint32_t m_dataSize;
+	int m_fd;
+	uint32_t m_blockSize;
+	uint32_t m_numEntries;
+	DkshaEntry const* m_entries;
+	DkshaEntry* m_entriesBuf; // only used when reading from a file
+	const char* m_names;
+	uint32_t m_namesSize;
+	Module* m_modules;
+	ShaderArena* m_arena;
+
+	bool readAt(uint32_t offset, void* buf, uint32_t size) noexcept;
+	DkResult materialize(uint32_t id) noexcept;
+
+public:
+	constexpr ShaderArchive(DkShaderArchiveMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_data{static_cast<const uint8_t*>(m.data)}, m_dataSize{m.dataSize}, m_fd{m.fd}, m_blockSize{m.blockSize},
+		m_numEntries{}, m_entries{}, m_entriesBuf{}, m_names{}, m_namesSize{}, m_modules{}, m_arena{} { }
+	~ShaderArchive() { destroy(); }
+
+	DkResult initialize() noexcept;
+	void destroy();
+
+	constexpr uint32_t getNumModules() const noexcept { return m_numEntries; }
+
+	uint32_t findModule(const char* name) const noexcept;
+	DkResult getShader(uint32_t id, uint32_t programId, DkShader const*& out) noexcept;
+};
+
+}
@@ -0,0 +1,283 @@
+#include "dk_shader_arena.h"
+#include "dk_device.h"
+#include "dk_shader.h"
+
+using namespace dk::detail;
+
+ShaderArena::~ShaderArena()
+{
+	for (uint32_t i = 0; i < m_numBlocks; i ++)
+		destroyBlock(m_blocks[i]);
+	if (m_blocks)
+		freeMem(m_blocks);
+}
+
+template <typename T>
+bool ShaderArena::growArray(T*& array, uint32_t count, uint32_t& capacity) noexcept
+{
+	if (count < capacity)
+		return true;
+
+	uint32_t newCapacity = capacity ? 2*capacity : 8;
+	T* newArray = static_cast<T*>(allocMem(newCapacity*sizeof(T)));
+	if (!newArray)
+		return false;
+
+	if (array)
+	{
+		memcpy(newArray, array, count*sizeof(T));
+		freeMem(array);
+	}
+
+	array = newArray;
+	capacity = newCapacity;
+	return true;
+}
+
+ShaderArena::Block* ShaderArena::findBlock(DkMemBlock mem) noexcept
+{
+	for (uint32_t i = 0; i < m_numBlocks; i ++)
+		if (m_blocks[i].m_mem == mem)
+			return &m_blocks[i];
+	return nullptr;
+}
+
+ShaderArena::Block* ShaderArena::newBlock(uint32_t minSize) noexcept
+{
+	if (!growArray(m_blocks, m_numBlocks, m_maxBlocks))
+		return nullptr;
+
+	// Oversized code gets a dedicated block
+	uint32_t bigPageSize = getDevice()->getGpuInfo().bigPageSize;
+	uint32_t size = minSize + DK_SHADER_CODE_UNUSABLE_SIZE;
+	size = (size + bigPageSize - 1) &~ (bigPageSize - 1);
+	if (size < m_blockSize)
+		size = m_blockSize;
+
+	DkMemBlock mem = new(getDevice()) MemBlock(getDevice());
+	DkResult res = mem->initialize(DkMemBlockFlags_CpuUncached | DkMemBlockFlags_GpuCached | DkMemBlockFlags_Code, nullptr, size);
+	if (res != DkResult_Success)
+	{
+		delete mem;
+		return nullptr;
+	}
+
+	Block& blk = m_blocks[m_numBlocks++];
+	blk.m_mem = mem;
+	blk.m_usableSize = size - DK_SHADER_CODE_UNUSABLE_SIZE;
+	blk.m_numEntries = 0;
+	blk.m_maxEntries = 0;
+	blk.m_entries = nullptr;
+	return &blk;
+}
+
+void ShaderArena::destroyBlock(Block& blk) noexcept
+{
+	delete blk.m_mem;
+	if (blk.m_entries)
+		freeMem(blk.m_entries);
+}
+
+bool ShaderArena::insertEntry(Block& blk, uint32_t pos, Entry const& entry) noexcept
+{
+	if (!growArray(blk.m_entries, blk.m_numEntries, blk.m_maxEntries))
+		return false;
+
+	memmove(&blk.m_entries[pos+1], &blk.m_entries[pos], (blk.m_numEntries-pos)*sizeof(Entry));
+	blk.m_entries[pos] = entry;
+	blk.m_numEntries ++;
+	return true;
+}
+
+DkResult ShaderArena::alloc(uint32_t size, void* userData, DkShaderCode& out)
+{
+	size = (size + DK_SHADER_CODE_ALIGNMENT - 1) &~ (DK_SHADER_CODE_ALIGNMENT - 1);
+	MutexHolder m{m_mutex};
+
+	// First fit: look for a gap between existing entries (or at the end of a block)
+	for (uint32_t i = 0; i < m_numBlocks; i ++)
+	{
+		Block& blk = m_blocks[i];
+		uint32_t cursor = 0;
+		for (uint32_t j = 0; j <= blk.m_numEntries; j ++)
+		{
+			uint32_t gapEnd = j < blk.m_numEntries ? blk.m_entries[j].m_offset : blk.m_usableSize;
+			if (gapEnd - cursor >= size)
+			{
+				if (!insertEntry(blk, j, { cursor, size, userData }))
+					return DkResult_OutOfMemory;
+				out = { blk.m_mem, cursor, size };
+				return DkResult_Success;
+			}
+			if (j < blk.m_numEntries)
+				cursor = blk.m_entries[j].m_offset + blk.m_entries[j].m_size;
+		}
+	}
+
+	// No room anywhere: create a new block
+	Block* blk = newBlock(size);
+	if (!blk)
+		return DkResult_OutOfMemory;
+	if (!insertEntry(*blk, 0, { 0, size, userData }))
+		return DkResult_OutOfMemory;
+
+	out = { blk->m_mem, 0, size };
+	return DkResult_Success;
+}
+
+void ShaderArena::free(DkShaderCode const& code)
+{
+	MutexHolder m{m_mutex};
+	Block* blk = findBlock(code.codeMem);
+	if (!blk)
+		return;
+
+	// Binary search for the entry
+	uint32_t lo = 0, hi = blk->m_numEntries;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (blk->m_entries[mid].m_offset < code.codeOffset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < blk->m_numEntries && blk->m_entries[lo].m_offset == code.codeOffset)
+	{
+		memmove(&blk->m_entries[lo], &blk->m_entries[lo+1], (blk->m_numEntries-lo-1)*sizeof(Entry));
+		blk->m_numEntries --;
+	}
+}
+
+uint32_t ShaderArena::compact(DkShaderArenaRelocFunc func, void* userData)
+{
+	// Code is moved with the CPU, so the GPU must not be running any shaders from this
+	// arena. Shaders living in moved code need to be initialized again (which is what
+	// the relocation callback is for), and shader caches need to be invalidated.
+	struct Reloc
+	{
+		void* m_userData;
+		DkShaderCode m_code;
+	};
+
+	Reloc* relocs = nullptr;
+	uint32_t numMoved = 0;
+	{
+		MutexHolder m{m_mutex};
+
+		// The relocation callback is invoked after the mutex is released (so that it
+		// may freely use the arena), which means the moves have to be recorded first
+		if (func)
+		{
+			uint32_t numEntries = 0;
+			for (uint32_t i = 0; i < m_numBlocks; i ++)
+				numEntries += m_blocks[i].m_numEntries;
+			if (numEntries)
+			{
+				relocs = static_cast<Reloc*>(allocMem(numEntries*sizeof(Reloc)));
+				if (!relocs)
+					return 0; // nothing is moved if the moves can't be reported
+			}
+		}
+
+		for (uint32_t i = 0; i < m_numBlocks; )
+		{
+			Block& blk = m_blocks[i];
+
+			// Release blocks that no longer hold any code
+			if (!blk.m_numEntries)
+			{
+				destroyBlock(blk);
+				m_blocks[i] = m_blocks[--m_numBlocks];
+				continue;
+			}
+
+			// Slide all code towards the start of the block
+			uint8_t* base = (uint8_t*)blk.m_mem->getCpuAddr();
+			uint32_t cursor = 0;
+			for (uint32_t j = 0; j < blk.m_numEntries; j ++)
+			{
+				Entry& entry = blk.m_entries[j];
+				if (entry.m_offset != cursor)
+				{
+					memmove(base + cursor, base + entry.m_offset, entry.m_size);
+					entry.m_offset = cursor;
+					if (relocs)
+						relocs[numMoved] = { entry.m_userData, { blk.m_mem, entry.m_offset, entry.m_size } };
+					numMoved ++;
+				}
+				cursor += entry.m_size;
+			}
+
+			i ++;
+		}
+	}
+
+	if (relocs)
+	{
+		for (uint32_t i = 0; i < numMoved; i ++)
+			func(userData, relocs[i].m_userData, &relocs[i].m_code);
+		freeMem(relocs);
+	}
+
+	return numMoved;
+}
+
+DkShaderArena dkShaderArenaCreate(DkShaderArenaMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_SIZE_ALIGN(maker->blockSize, maker->device->getGpuInfo().bigPageSize);
+	DK_DEBUG_NON_ZERO(maker->blockSize);
+
+	DkShaderArena obj = new(maker->device) ShaderArena(*maker);
+	return obj;
+}
+
+void dkShaderArenaDestroy(DkShaderArena obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+DkResult dkShaderArenaAlloc(DkShaderArena obj, uint32_t size, void* userData, DkShaderCode* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_ZERO(size);
+	DK_DEBUG_NON_NULL(out);
+	return obj->alloc(size, userData, *out);
+}
+
+DkResult dkShaderArenaLoad(DkShaderArena obj, const void* dksh, uint32_t dkshSize, void* userData, DkShaderCode* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(dksh);
+	DK_DEBUG_NON_NULL(out);
+
+	DkshHeader const* hdr = (DkshHeader const*)dksh;
+	DK_DEBUG_BAD_INPUT(dkshSize < sizeof(DkshHeader) || hdr->magic != DKSH_MAGIC, "invalid DKSH shader");
+	DK_DEBUG_BAD_INPUT(!CheckDkshSize(*hdr, dkshSize), "truncated DKSH shader");
+	DK_DEBUG_SIZE_ALIGN(hdr->code_sz, DK_SHADER_CODE_ALIGNMENT);
+
+	// Only the code section is placed in code memory, the control section is to be
+	// passed as DkShaderMaker::control when initializing the shaders in the module
+	DkResult res = obj->alloc(hdr->code_sz, userData, *out);
+	if (res != DkResult_Success)
+		return res;
+
+	memcpy((uint8_t*)out->codeMem->getCpuAddr() + out->codeOffset, (uint8_t const*)dksh + hdr->control_sz, hdr->code_sz);
+	return DkResult_Success;
+}
+
+void dkShaderArenaFree(DkShaderArena obj, DkShaderCode const* code)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(code);
+	obj->free(*code);
+}
+
+uint32_t dkShaderArenaCompact(DkShaderArena obj, DkShaderArenaRelocFunc func, void* userData)
+{
+	DK_ENTRYPOINT(obj);
+	return obj->compact(func, userData);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_memblock.h"
+
+namespace dk::detail
+{
+
+class ShaderArena : public ObjBase
+{
+	struct Entry
+	{
+		uint32_t m_offset;
+		uint32_t m_size;
+		void* m_userData;
+	};
+
+	struct Block
+	{
+		DkMemBlock m_mem;
+		uint32_t m_usableSize;
+		uint32_t m_numEntries;
+		uint32_t m_maxEntries;
+		Entry* m_entries; // sorted by offset
+	};
+
+	Mutex m_mutex;
+	uint32_t m_blockSize;
+	uint32_t m_numBlocks;
+	uint32_t m_maxBlocks;
+	Block* m_blocks;
+
+	template <typename T>
+	bool growArray(T*& array, uint32_t count, uint32_t& capacity) noexcept;
+
+	Block* findBlock(DkMemBlock mem) noexcept;
+	Block* newBlock(uint32_t minSize) noexcept;
+	void destroyBlock(Block& blk) noexcept;
+	bool insertEntry(Block& blk, uint32_t pos, Entry const& entry) noexcept;
+
+public:
+	constexpr ShaderArena(DkShaderArenaMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_blockSize{m.blockSize}, m_numBlocks{}, m_maxBlocks{}, m_blocks{} { }
+	~ShaderArena();
+
+	DkResult alloc(uint32_t size, void* userData, DkShaderCode& out) noexcept;
+	void free(DkShaderCode const& code) noexcept;
+	uint32_t compact(DkShaderArenaRelocFunc func, void* userData) noexcept;
+};
+
+}
@@ -0,0 +1,385 @@
+#include <stdlib.h>
+#include "dk_shader_cache.h"
+#include "dk_shader.h"
+#include "dk_device.h"
+
+using namespace dk::detail;
+
+namespace
+{
+	int compareBounds(const void* a, const void* b)
+	{
+		uint32_t lhs = *(uint32_t const*)a, rhs = *(uint32_t const*)b;
+		return lhs < rhs ? -1 : lhs > rhs;
+	}
+
+	template <typename T>
+	int compareBegin(const void* a, const void* b)
+	{
+		return compareBounds(&static_cast<T const*>(a)->m_begin, &static_cast<T const*>(b)->m_begin);
+	}
+
+	uint32_t nextBound(uint32_t const* bounds, uint32_t numBounds, uint32_t offset)
+	{
+		// Smallest boundary strictly above offset (the last one is always the end of the code section)
+		uint32_t lo = 0, hi = numBounds - 1;
+		while (lo < hi)
+		{
+			uint32_t mid = (lo + hi) / 2;
+			if (bounds[mid] <= offset)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return bounds[lo];
+	}
+}
+
+DkResult ShaderCodeCache::initialize(DkShaderCodeCacheMaker const& m)
+{
+	uint32_t numBuckets = 1;
+	while (numBuckets < m_maxEntries)
+		numBuckets <<= 1;
+	m_bucketMask = numBuckets - 1;
+
+	m_entries = static_cast<Entry*>(allocMem(m_maxEntries*sizeof(Entry)));
+	m_buckets = static_cast<uint32_t*>(allocMem(numBuckets*sizeof(uint32_t)));
+	m_sorted = static_cast<uint32_t*>(allocMem(m_maxEntries*sizeof(uint32_t)));
+	if (!m_entries || !m_buckets || !m_sorted)
+		return DkResult_OutOfMemory;
+
+	memset(m_buckets, 0, numBuckets*sizeof(uint32_t));
+	for (uint32_t i = 0; i < m_maxEntries; i ++)
+	{
+		m_entries[i] = {};
+		m_entries[i].m_next = i + 2;
+	}
+	m_firstFree = 1;
+
+	DkShaderArenaMaker arenaMaker;
+	dkShaderArenaMakerDefaults(&arenaMaker, getDevice());
+	arenaMaker.blockSize = m.blockSize;
+	m_arena = new(getDevice()) ShaderArena(arenaMaker);
+	if (!m_arena)
+		return DkResult_OutOfMemory;
+
+	return DkResult_Success;
+}
+
+void ShaderCodeCache::destroy()
+{
+	for (uint32_t i = 0; i < m_numUsed; i ++)
+		freeMem(m_entries[m_sorted[i]].m_shadow);
+	m_numUsed = 0;
+
+	if (m_arena)
+	{
+		delete m_arena;
+		m_arena = nullptr;
+	}
+
+	if (m_sorted)
+	{
+		freeMem(m_sorted);
+		m_sorted = nullptr;
+	}
+
+	if (m_buckets)
+	{
+		freeMem(m_buckets);
+		m_buckets = nullptr;
+	}
+
+	if (m_entries)
+	{
+		freeMem(m_entries);
+		m_entries = nullptr;
+	}
+}
+
+uint64_t ShaderCodeCache::hashCode(const void* code, uint32_t size)
+{
+	// FNV-1a over the code words (code is always a multiple of DK_SHADER_CODE_ALIGNMENT in size)
+	const uint32_t* words = static_cast<const uint32_t*>(code);
+	uint64_t hash = UINT64_C(14695981039346656037);
+	for (uint32_t i = 0; i < size/4; i ++)
+	{
+		hash ^= words[i];
+		hash *= UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+uint32_t ShaderCodeCache::lowerBound(uint32_t codeSegStart) const
+{
+	// Position of the first used entry placed at or above codeSegStart
+	uint32_t lo = 0, hi = m_numUsed;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (m_entries[m_sorted[mid]].m_codeSegStart < codeSegStart)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+uint32_t ShaderCodeCache::acquire(const void* code, uint32_t size, uint32_t numRefs)
+{
+	// Must be called with the mutex held
+	uint64_t hash = hashCode(code, size);
+	uint32_t* bucket = &m_buckets[uint32_t(hash ^ (hash >> 32)) & m_bucketMask];
+	for (uint32_t link = *bucket; link; link = m_entries[link - 1].m_next)
+	{
+		// Hashes are not trusted blindly: the new code is compared against the CPU-side
+		// copy of the cached code (the code memory itself is far too slow to read back)
+		Entry& e = m_entries[link - 1];
+		if (e.m_hash == hash && e.m_code.size == size && memcmp(e.m_shadow, code, size) == 0)
+		{
+			e.m_refCount += numRefs;
+			return link - 1;
+		}
+	}
+
+	if (!m_firstFree || m_firstFree > m_maxEntries)
+		return UINT32_MAX;
+
+	uint32_t id = m_firstFree - 1;
+	Entry& e = m_entries[id];
+	e.m_shadow = allocMem(size);
+	if (!e.m_shadow)
+		return UINT32_MAX;
+	if (m_arena->alloc(size, &e, e.m_code) != DkResult_Success)
+	{
+		freeMem(e.m_shadow);
+		return UINT32_MAX;
+	}
+
+	memcpy(e.m_shadow, code, size);
+	memcpy((u8*)e.m_code.codeMem->getCpuAddr() + e.m_code.codeOffset, code, size);
+	m_firstFree = e.m_next;
+	e.m_hash = hash;
+	e.m_codeSegStart = e.m_code.codeMem->getCodeSegOffset() + e.m_code.codeOffset;
+	e.m_refCount = numRefs;
+	e.m_next = *bucket;
+	*bucket = id + 1;
+
+	uint32_t pos = lowerBound(e.m_codeSegStart);
+	memmove(&m_sorted[pos + 1], &m_sorted[pos], (m_numUsed - pos)*sizeof(uint32_t));
+	m_sorted[pos] = id;
+	m_numUsed ++;
+	return id;
+}
+
+void ShaderCodeCache::release(uint32_t id, uint32_t numRefs)
+{
+	// Must be called with the mutex held
+	Entry& e = m_entries[id];
+	e.m_refCount -= numRefs;
+	if (e.m_refCount)
+		return;
+
+	uint32_t* link = &m_buckets[uint32_t(e.m_hash ^ (e.m_hash >> 32)) & m_bucketMask];
+	while (*link != id + 1)
+		link = &m_entries[*link - 1].m_next;
+	*link = e.m_next;
+
+	uint32_t pos = lowerBound(e.m_codeSegStart);
+	m_numUsed --;
+	memmove(&m_sorted[pos], &m_sorted[pos + 1], (m_numUsed - pos)*sizeof(uint32_t));
+
+	m_arena->free(e.m_code);
+	freeMem(e.m_shadow);
+	e.m_shadow = nullptr;
+	e.m_next = m_firstFree;
+	m_firstFree = id + 1;
+}
+
+DkResult ShaderCodeCache::load(const void* dksh, uint32_t dkshSize, DkShader shaders[], uint32_t maxShaders, uint32_t* numShaders)
+{
+	// Modules in memory never need a control buffer, so there is nothing to close
+	DkshModule mod = { dksh, dkshSize, -1, nullptr, nullptr };
+	DkResult res = mod.open(*this);
+	if (res != DkResult_Success)
+		return res;
+
+	DkshHeader const& hdr = *mod.m_hdr;
+
+	u8 const* code = (u8 const*)dksh + hdr.control_sz;
+	auto* progTable = (DkshProgramHeader const*)((u8 const*)dksh + hdr.programs_off);
+	uint32_t numProgs = hdr.num_programs;
+	uint32_t numInit = numProgs < maxShaders ? numProgs : maxShaders;
+	if (numShaders)
+		*numShaders = numProgs;
+	if (!numInit)
+		return DkResult_Success;
+
+	// Scratch memory: one span per program (later reused for the merged spans),
+	// the group each program belongs to, and the sorted code boundaries
+	size_t scratchSize = numProgs*(sizeof(Span) + sizeof(uint32_t)) + (2*numProgs + 1)*sizeof(uint32_t);
+	void* scratch = allocMem(scratchSize);
+	if (!scratch)
+		return DkResult_OutOfMemory;
+
+	Span* spans = static_cast<Span*>(scratch);
+	uint32_t* progGroup = reinterpret_cast<uint32_t*>(spans + numProgs);
+	uint32_t* bounds = progGroup + numProgs;
+
+	// The DKSH format doesn't record the size of each program's code. Instead, each
+	// piece of code (or constbuf) is assumed to extend up to the next one. Programs
+	// with secondary code are kept along with the whole code section, as are programs
+	// whose pieces end up overlapping after being rounded to the code alignment.
+	uint32_t numBounds = 0;
+	bool keepWhole = false;
+	for (uint32_t i = 0; i < numProgs; i ++)
+	{
+		DkshProgramHeader const& prog = progTable[i];
+		if (prog.entrypoint >= hdr.code_sz || prog.constbuf1_off > hdr.code_sz || prog.constbuf1_sz > hdr.code_sz - prog.constbuf1_off)
+		{
+			freeMem(scratch);
+			return DkResult_BadInput;
+		}
+
+		if (prog.type == DkshProgramType_Vertex && prog.vert.alt_num_gprs)
+			keepWhole = true;
+		bounds[numBounds++] = prog.entrypoint;
+		if (prog.constbuf1_sz)
+			bounds[numBounds++] = prog.constbuf1_off;
+	}
+	bounds[numBounds++] = hdr.code_sz;
+	qsort(bounds, numBounds, sizeof(uint32_t), compareBounds);
+
+	for (uint32_t i = 0; i < numProgs; i ++)
+	{
+		DkshProgramHeader const& prog = progTable[i];
+		uint32_t begin = prog.entrypoint;
+		uint32_t end = nextBound(bounds, numBounds, begin);
+		if (prog.constbuf1_sz)
+		{
+			uint32_t cbufEnd = nextBound(bounds, numBounds, prog.constbuf1_off);
+			if (prog.constbuf1_off < begin) begin = prog.constbuf1_off;
+			if (cbufEnd > end) end = cbufEnd;
+		}
+
+		spans[i].m_begin = keepWhole ? 0 : begin &~ (DK_SHADER_CODE_ALIGNMENT - 1);
+		spans[i].m_end = keepWhole ? hdr.code_sz : (end + DK_SHADER_CODE_ALIGNMENT - 1) &~ (DK_SHADER_CODE_ALIGNMENT - 1);
+		spans[i].m_entry = i;
+	}
+
+	// Merge overlapping spans into groups sharing a single placement
+	qsort(spans, numProgs, sizeof(Span), compareBegin<Span>);
+	uint32_t numGroups = 0;
+	for (uint32_t i = 0; i < numProgs; i ++)
+	{
+		Span const cur = spans[i];
+		if (numGroups && cur.m_begin < spans[numGroups-1].m_end)
+		{
+			if (cur.m_end > spans[numGroups-1].m_end)
+				spans[numGroups-1].m_end = cur.m_end;
+		}
+		else
+			spans[numGroups++] = { cur.m_begin, cur.m_end, 0 };
+		progGroup[cur.m_entry] = numGroups - 1;
+	}
+
+	// Place (or find) the code of each group, taking one reference per initialized shader
+	MutexHolder m{m_mutex};
+	for (uint32_t g = 0; g < numGroups; g ++)
+	{
+		uint32_t numRefs = 0;
+		for (uint32_t i = 0; i < numInit; i ++)
+			numRefs += progGroup[i] == g;
+
+		spans[g].m_entry = UINT32_MAX;
+		if (!numRefs)
+			continue;
+
+		spans[g].m_entry = acquire(code + spans[g].m_begin, spans[g].m_end - spans[g].m_begin, numRefs);
+		if (spans[g].m_entry == UINT32_MAX)
+		{
+			// Roll back the groups placed so far
+			for (uint32_t j = 0; j < g; j ++)
+			{
+				if (spans[j].m_entry == UINT32_MAX)
+					continue;
+				numRefs = 0;
+				for (uint32_t i = 0; i < numInit; i ++)
+					numRefs += progGroup[i] == j;
+				release(spans[j].m_entry, numRefs);
+			}
+			freeMem(scratch);
+			return DkResult_OutOfMemory;
+		}
+	}
+
+	for (uint32_t i = 0; i < numInit; i ++)
+	{
+		Span const& span = spans[progGroup[i]];
+		DkShaderCode const& placed = m_entries[span.m_entry].m_code;
+		InitShader(&shaders[i], placed.codeMem, progTable[i], placed.codeOffset - span.m_begin);
+	}
+
+	freeMem(scratch);
+	return DkResult_Success;
+}
+
+void ShaderCodeCache::releaseShaders(DkShader const shaders[], uint32_t numShaders)
+{
+	MutexHolder m{m_mutex};
+	for (uint32_t i = 0; i < numShaders; i ++)
+	{
+		// Entries never overlap, so the one holding the entrypoint is the last one placed at or below it
+		uint32_t entrypoint = shaders[i].m_hdr.entrypoint;
+		uint32_t pos = lowerBound(entrypoint + 1);
+		if (!pos)
+			continue;
+		uint32_t id = m_sorted[pos - 1];
+		if (entrypoint - m_entries[id].m_codeSegStart < m_entries[id].m_code.size)
+			release(id, 1);
+	}
+}
+
+DkShaderCodeCache dkShaderCodeCacheCreate(DkShaderCodeCacheMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_ZERO(maker->maxEntries);
+	DK_DEBUG_NON_ZERO(maker->blockSize);
+	DK_DEBUG_SIZE_ALIGN(maker->blockSize, maker->device->getGpuInfo().bigPageSize);
+
+	DkShaderCodeCache obj = new(maker->device) ShaderCodeCache(*maker);
+	DkResult res = obj->initialize(*maker);
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkShaderCodeCacheDestroy(DkShaderCodeCache obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+uint32_t dkShaderCodeCacheGetNumEntries(DkShaderCodeCache obj)
+{
+	return obj->getNumEntries();
+}
+
+DkResult dkShaderCodeCacheLoad(DkShaderCodeCache obj, const void* dksh, uint32_t dkshSize, DkShader shaders[], uint32_t maxShaders, uint32_t* numShaders)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(dksh);
+	DK_DEBUG_NON_NULL_ARRAY(shaders, maxShaders);
+	return obj->load(dksh, dkshSize, shaders, maxShaders, numShaders);
+}
+
+void dkShaderCodeCacheRelease(DkShaderCodeCache obj, DkShader const shaders[], uint32_t numShaders)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL_ARRAY(shaders, numShaders);
+	obj->releaseShaders(shaders, numShaders);
+}
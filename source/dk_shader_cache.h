@@ -0,0 +1,61 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_shader_arena.h"
+
+namespace dk::detail
+{
+
+class ShaderCodeCache : public ObjBase
+{
+	// Placement of a piece of code (one or more programs along with their constbufs),
+	// shared between all shaders whose code is byte for byte identical
+	struct Entry
+	{
+		uint64_t m_hash;
+		DkShaderCode m_code;
+		void* m_shadow;      // CPU-side copy of the code, for comparisons
+		uint32_t m_codeSegStart;
+		uint32_t m_refCount; // one per shader using the entry, zero for free entries
+		uint32_t m_next;     // next entry in the bucket (or free list) plus one
+	};
+
+	struct Span
+	{
+		uint32_t m_begin;
+		uint32_t m_end;
+		uint32_t m_entry;
+	};
+
+	Mutex m_mutex;
+	ShaderArena* m_arena; // private, so that it is never compacted behind our back
+	uint32_t m_maxEntries;
+	uint32_t m_bucketMask;
+	uint32_t m_firstFree;
+	uint32_t m_numUsed;
+	Entry* m_entries;
+	uint32_t* m_buckets;
+	uint32_t* m_sorted; // ids of the used entries, sorted by code segment offset
+
+	static uint64_t hashCode(const void* code, uint32_t size) noexcept;
+
+	uint32_t lowerBound(uint32_t codeSegStart) const noexcept;
+
+	uint32_t acquire(const void* code, uint32_t size, uint32_t numRefs) noexcept;
+	void release(uint32_t id, uint32_t numRefs) noexcept;
+
+public:
+	constexpr ShaderCodeCache(DkShaderCodeCacheMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_arena{}, m_maxEntries{m.maxEntries}, m_bucketMask{}, m_firstFree{}, m_numUsed{},
+		m_entries{}, m_buckets{}, m_sorted{} { }
+	~ShaderCodeCache() { destroy(); }
+
+	DkResult initialize(DkShaderCodeCacheMaker const& m) noexcept;
+	void destroy();
+
+	constexpr uint32_t getNumEntries() const noexcept { return m_numUsed; }
+
+	DkResult load(const void* dksh, uint32_t dkshSize, DkShader shaders[], uint32_t maxShaders, uint32_t* numShaders) noexcept;
+	void releaseShaders(DkShader const shaders[], uint32_t numShaders) noexcept;
+};
+
+}
@@ -0,0 +1,257 @@
+#include "dk_shader_loader.h"
+#include "dk_shader_arena.h"
+#include "dk_shader.h"
+#include "dk_device.h"
+#include "dk_memblock.h"
+
+using namespace dk::detail;
+
+DkResult ShaderLoader::initialize()
+{
+	// Applications can only run threads on cores 0-2
+	m_threadCpuMask &= 0x7;
+	if (!m_threadCpuMask)
+		return DkResult_BadInput;
+
+	m_queue = static_cast<DkShaderLoadJob**>(allocMem(m_maxQueuedJobs*sizeof(DkShaderLoadJob*)));
+	if (!m_queue)
+		return DkResult_OutOfMemory;
+
+	// Spread the workers over the allowed cores, wrapping around if there are more workers than cores
+	uint32_t cpuMask = 0;
+	for (m_numStarted = 0; m_numStarted < m_numThreads; m_numStarted ++)
+	{
+		if (!cpuMask)
+			cpuMask = m_threadCpuMask;
+		int cpuId = __builtin_ctz(cpuMask);
+		cpuMask &= cpuMask - 1;
+
+		Thread* t = &m_threads[m_numStarted];
+		if (R_FAILED(threadCreate(t, workerMain, this, nullptr, s_stackSize, m_threadPriority, cpuId)))
+			return DkResult_Fail;
+		if (R_FAILED(threadStart(t)))
+		{
+			threadClose(t);
+			return DkResult_Fail;
+		}
+	}
+
+	return DkResult_Success;
+}
+
+void ShaderLoader::destroy()
+{
+	// Workers drain the queue before honouring the quit request
+	if (m_numStarted)
+	{
+		{
+			MutexHolder m{m_mutex};
+			m_quit = true;
+			condvarWakeAll(&m_workCondVar);
+		}
+
+		for (uint32_t i = 0; i < m_numStarted; i ++)
+		{
+			threadWaitForExit(&m_threads[i]);
+			threadClose(&m_threads[i]);
+		}
+		m_numStarted = 0;
+	}
+
+	if (m_queue)
+	{
+		freeMem(m_queue);
+		m_queue = nullptr;
+	}
+}
+
+void ShaderLoader::workerMain(void* arg)
+{
+	ShaderLoader* self = static_cast<ShaderLoader*>(arg);
+	for (;;)
+	{
+		DkShaderLoadJob* job;
+		{
+			MutexHolder m{self->m_mutex};
+			while (!self->m_queueCount && !self->m_quit)
+				condvarWait(&self->m_workCondVar, &self->m_mutex);
+			if (!self->m_queueCount)
+				break;
+
+			job = self->m_queue[self->m_queueHead];
+			self->m_queueHead = (self->m_queueHead + 1) % self->m_maxQueuedJobs;
+			self->m_queueCount --;
+			condvarWakeAll(&self->m_doneCondVar); // a queue slot was freed up
+		}
+
+		// Reading, validating and copying happen without holding the loader's mutex
+		job->result = self->process(*job);
+		self->complete(job);
+	}
+}
+
+void ShaderLoader::complete(DkShaderLoadJob* job)
+{
+	// Waiters are allowed to release the job as soon as they observe it as done,
+	// so the callback is handed a copy taken beforehand. It also runs without
+	// holding the mutex, leaving it free to submit more jobs.
+	DkShaderLoadJob copy = *job;
+	copy.done = true;
+	{
+		MutexHolder m{m_mutex};
+		if (copy.result == DkResult_Success)
+			m_numPlaced ++;
+		m_numPending --;
+		job->done = true;
+		condvarWakeAll(&m_doneCondVar);
+	}
+
+	if (m_cbDone)
+		m_cbDone(m_userData, &copy);
+}
+
+bool ShaderLoader::isWorkerThread() const
+{
+	Thread const* self = threadGetSelf();
+	for (uint32_t i = 0; i < m_numStarted; i ++)
+		if (self == &m_threads[i])
+			return true;
+	return false;
+}
+
+DkResult ShaderLoader::process(DkShaderLoadJob& job)
+{
+	job.numShaders = 0;
+
+	// Find (or read in) the control section
+	DkshModule mod = { job.source, job.sourceSize, job.fd, nullptr, nullptr };
+	DkResult res = mod.open(*this);
+
+	// Reserving the code space is the only step that contends with other workers
+	// (the arena's mutex, and the code segment's mutex when a new block is needed)
+	if (res == DkResult_Success)
+		res = m_arena->alloc(mod.m_hdr->code_sz, job.userData, job.code);
+
+	if (res == DkResult_Success && !mod.readCode((u8*)job.code.codeMem->getCpuAddr() + job.code.codeOffset))
+	{
+		m_arena->free(job.code);
+		job.code = {};
+		res = DkResult_Fail;
+	}
+
+	if (res == DkResult_Success)
+		job.numShaders = mod.initShaders(job.shaders, job.maxShaders, job.code.codeMem, job.code.codeOffset);
+
+	mod.close(*this);
+	return res;
+}
+
+void ShaderLoader::submit(DkShaderLoadJob* const jobs[], uint32_t numJobs)
+{
+	// Jobs submitted from the done callback can't wait for a queue slot, since
+	// the worker running the callback might be the one that would free it up
+	const bool fromWorker = isWorkerThread();
+	for (uint32_t i = 0; i < numJobs; i ++)
+	{
+		{
+			MutexHolder m{m_mutex};
+			jobs[i]->done = false;
+			jobs[i]->submitted = true;
+			m_numPending ++;
+
+			if (!fromWorker || m_queueCount < m_maxQueuedJobs)
+			{
+				// Block while the queue is full
+				while (m_queueCount == m_maxQueuedJobs)
+					condvarWait(&m_doneCondVar, &m_mutex);
+
+				m_queue[(m_queueHead + m_queueCount) % m_maxQueuedJobs] = jobs[i];
+				m_queueCount ++;
+				condvarWakeOne(&m_workCondVar);
+				continue;
+			}
+		}
+
+		// The queue is full and this is a worker: process the job right away
+		jobs[i]->result = process(*jobs[i]);
+		complete(jobs[i]);
+	}
+}
+
+void ShaderLoader::wait(DkShaderLoadJob const* job)
+{
+	MutexHolder m{m_mutex};
+	if (!job->submitted)
+		return;
+	while (!job->done)
+		condvarWait(&m_doneCondVar, &m_mutex);
+}
+
+bool ShaderLoader::finish()
+{
+	MutexHolder m{m_mutex};
+	while (m_numPending)
+		condvarWait(&m_doneCondVar, &m_mutex);
+
+	bool placed = m_numPlaced != 0;
+	m_numPlaced = 0;
+	return placed;
+}
+
+DkShaderLoader dkShaderLoaderCreate(DkShaderLoaderMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_NULL(maker->arena);
+	DK_DEBUG_BAD_INPUT(!maker->numThreads || maker->numThreads > ShaderLoader::s_maxThreads, "invalid number of worker threads");
+	DK_DEBUG_NON_ZERO(maker->maxQueuedJobs);
+	DK_DEBUG_BAD_INPUT(!(maker->threadCpuMask & 0x7), "no usable cores in threadCpuMask");
+
+	DkShaderLoader obj = new(maker->device) ShaderLoader(*maker);
+	DkResult res = obj->initialize();
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkShaderLoaderDestroy(DkShaderLoader obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+void dkShaderLoaderSubmit(DkShaderLoader obj, DkShaderLoadJob* const jobs[], uint32_t numJobs)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL_ARRAY(jobs, numJobs);
+#ifdef DEBUG
+	for (uint32_t i = 0; i < numJobs; i ++)
+	{
+		DK_DEBUG_BAD_INPUT(!jobs[i]->source && jobs[i]->fd < 0, "either source or fd must be provided");
+		DK_DEBUG_NON_NULL_ARRAY(jobs[i]->shaders, jobs[i]->maxShaders);
+	}
+#endif
+	obj->submit(jobs, numJobs);
+}
+
+void dkShaderLoaderWait(DkShaderLoader obj, DkShaderLoadJob const* job)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(job);
+	DK_DEBUG_BAD_STATE(!job->submitted, "job was never submitted");
+	obj->wait(job);
+}
+
+void dkShaderLoaderFinish(DkShaderLoader obj, DkCmdBuf cmdbuf)
+{
+	DK_ENTRYPOINT(obj);
+
+	// Whatever code got placed since the last call may be reusing memory that
+	// previously held other code, so the GPU's shader caches are invalidated
+	// once for the whole batch rather than once per module
+	if (obj->finish() && cmdbuf)
+		dkCmdBufBarrier(cmdbuf, DkBarrier_None, DkInvalidateFlags_Shader);
+}
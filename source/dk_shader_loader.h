@@ -0,0 +1,57 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+
+class ShaderLoader : public ObjBase
+{
+public:
+	static constexpr uint32_t s_maxThreads = 8;
+	static constexpr size_t s_stackSize = 0x8000;
+
+private:
+	Mutex m_mutex;
+	CondVar m_workCondVar; // signalled when jobs are queued, or when quitting
+	CondVar m_doneCondVar; // signalled when a job completes
+
+	DkShaderArena m_arena;
+	void* m_userData;
+	DkShaderLoadDoneFunc m_cbDone;
+	uint32_t m_numThreads;
+	uint32_t m_maxQueuedJobs;
+	int m_threadPriority;
+	uint32_t m_threadCpuMask;
+
+	DkShaderLoadJob** m_queue; // ring buffer
+	uint32_t m_queueHead;
+	uint32_t m_queueCount;
+	uint32_t m_numPending; // queued or being processed
+	uint32_t m_numPlaced; // jobs that placed code since the last finish()
+	uint32_t m_numStarted;
+	bool m_quit;
+	Thread m_threads[s_maxThreads];
+
+	static void workerMain(void* arg) noexcept;
+	DkResult process(DkShaderLoadJob& job) noexcept;
+	void complete(DkShaderLoadJob* job) noexcept;
+	bool isWorkerThread() const noexcept;
+
+public:
+	constexpr ShaderLoader(DkShaderLoaderMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_workCondVar{}, m_doneCondVar{},
+		m_arena{m.arena}, m_userData{m.userData}, m_cbDone{m.cbDone}, m_numThreads{m.numThreads},
+		m_maxQueuedJobs{m.maxQueuedJobs}, m_threadPriority{m.threadPriority}, m_threadCpuMask{m.threadCpuMask},
+		m_queue{}, m_queueHead{}, m_queueCount{}, m_numPending{}, m_numPlaced{}, m_numStarted{}, m_quit{},
+		m_threads{} { }
+	~ShaderLoader() { destroy(); }
+
+	DkResult initialize() noexcept;
+	void destroy();
+
+	void submit(DkShaderLoadJob* const jobs[], uint32_t numJobs) noexcept;
+	void wait(DkShaderLoadJob const* job) noexcept;
+	bool finish() noexcept;
+};
+
+}
@@ -0,0 +1,174 @@
+#include "dk_sparse.h"
+#include "dk_device.h"
+#include "dk_memblock.h"
+
+using namespace dk::detail;
+
+uint32_t SparseImage::getPageSize() const
+{
+	return getDevice()->getGpuInfo().bigPageSize;
+}
+
+DkResult SparseImage::initialize()
+{
+	// Only layouts with their tiles aligned to pages can be committed piecewise
+	if ((m_layout.m_flags & (DkImageFlags_UsageSparse | DkImageFlags_PitchLinear)) != DkImageFlags_UsageSparse)
+		return DkResult_BadInput;
+
+	uint32_t pageSize = getPageSize();
+	uint64_t size = (m_layout.m_storageSize + pageSize - 1) &~ uint64_t(pageSize - 1);
+	m_numPages = size / pageSize;
+
+	m_pageMap = static_cast<uint32_t*>(allocMem(((m_numPages + 31) / 32) * sizeof(uint32_t)));
+	if (!m_pageMap)
+		return DkResult_OutOfMemory;
+	memset(m_pageMap, 0, ((m_numPages + 31) / 32) * sizeof(uint32_t));
+
+	// Reserve the whole range as sparse: pages that aren't backed by memory
+	// are still valid to access on the GPU (reads return zero, writes are dropped).
+	if (R_FAILED(nvAddressSpaceAlloc(getDevice()->getAddrSpace(), true, size, &m_iova)))
+	{
+		m_iova = DK_GPU_ADDR_INVALID;
+		return DkResult_Fail;
+	}
+
+	return DkResult_Success;
+}
+
+void SparseImage::destroy()
+{
+	if (m_iova != DK_GPU_ADDR_INVALID)
+	{
+		for (uint32_t i = 0; i < m_numPages; i ++)
+			if (isPageMapped(i))
+				unmapPage(i);
+		nvAddressSpaceFree(getDevice()->getAddrSpace(), m_iova, uint64_t(m_numPages) * getPageSize());
+		m_iova = DK_GPU_ADDR_INVALID;
+	}
+
+	if (m_pageMap)
+	{
+		freeMem(m_pageMap);
+		m_pageMap = nullptr;
+	}
+}
+
+void SparseImage::unmapPage(uint32_t page)
+{
+	// Unmapping a page within a sparse reservation turns it back into a sparse page
+	nvAddressSpaceUnmap(getDevice()->getAddrSpace(), m_iova + uint64_t(page) * getPageSize());
+	setPageMapped(page, false);
+}
+
+DkResult SparseImage::commit(uint64_t offset, uint64_t size, DkMemBlock memBlock, uint32_t memOffset)
+{
+	NvAddressSpace* as = getDevice()->getAddrSpace();
+	uint32_t pageSize = getPageSize();
+	uint32_t firstPage = offset / pageSize;
+	uint32_t numPages = size / pageSize;
+	uint32_t flags = NvMapBufferFlags_FixedOffset;
+	if (memBlock->isGpuCached())
+		flags |= NvMapBufferFlags_IsCacheable;
+
+	MutexHolder m{m_mutex};
+	for (uint32_t i = 0; i < numPages; i ++)
+	{
+		uint32_t page = firstPage + i;
+		if (isPageMapped(page))
+			unmapPage(page);
+
+		u64 iova = m_iova + uint64_t(page) * pageSize;
+		if (R_FAILED(nvioctlNvhostAsGpu_MapBufferEx(as->fd, flags, m_layout.m_memKind, memBlock->getHandle(),
+			pageSize, memOffset + i*pageSize, pageSize, iova, &iova)))
+		{
+			// Don't leave a partial commit behind: pages mapped so far go back to
+			// being sparse (as do pages this commit already unmapped for remapping)
+			while (i--)
+				unmapPage(firstPage + i);
+			return DkResult_Fail;
+		}
+
+		setPageMapped(page, true);
+	}
+
+	return DkResult_Success;
+}
+
+void SparseImage::decommit(uint64_t offset, uint64_t size)
+{
+	uint32_t pageSize = getPageSize();
+	uint32_t firstPage = offset / pageSize;
+	uint32_t numPages = size / pageSize;
+
+	MutexHolder m{m_mutex};
+	for (uint32_t i = 0; i < numPages; i ++)
+		if (isPageMapped(firstPage + i))
+			unmapPage(firstPage + i);
+}
+
+DkSparseImage dkSparseImageCreate(DkSparseImageMaker const* maker)
+{
+	DK_ENTRYPOINT(maker->device);
+	DK_DEBUG_NON_NULL(maker->layout);
+	DK_DEBUG_BAD_INPUT(maker->layout->m_flags & DkImageFlags_PitchLinear, "sparse images must be block linear");
+	DK_DEBUG_BAD_FLAGS(!(maker->layout->m_flags & DkImageFlags_UsageSparse), "layout must be created with DkImageFlags_UsageSparse");
+	DK_DEBUG_BAD_INPUT(maker->layout->m_flags & DkImageFlags_HwCompression, "sparse images cannot use hardware compression");
+
+	DkSparseImage obj = new(maker->device) SparseImage(*maker);
+	DkResult res = obj->initialize();
+	if (res != DkResult_Success)
+	{
+		delete obj;
+		DK_ERROR(res, "initialization failure");
+		return nullptr;
+	}
+	return obj;
+}
+
+void dkSparseImageDestroy(DkSparseImage obj)
+{
+	DK_ENTRYPOINT(obj);
+	delete obj;
+}
+
+uint32_t dkSparseImageGetPageSize(DkSparseImage obj)
+{
+	DK_ENTRYPOINT(obj);
+	return obj->getPageSize();
+}
+
+void dkSparseImageInitImage(DkSparseImage obj, DkImage* out)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(out);
+
+	memcpy(out, &obj->getLayout(), sizeof(DkImageLayout));
+	out->m_iova = obj->getGpuAddr();
+	out->m_memBlock = nullptr;
+	out->m_memOffset = 0;
+}
+
+DkResult dkSparseImageCommit(DkSparseImage obj, uint64_t offset, uint64_t size, DkMemBlock memBlock, uint32_t memOffset)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_NON_NULL(memBlock);
+	DK_DEBUG_BAD_INPUT(memBlock->isGpuNoAccess(), "memory block must be GPU accessible");
+	DK_DEBUG_BAD_FLAGS(!memBlock->isImage(), "DkMemBlock must be created with DkMemBlockFlags_Image");
+	DK_DEBUG_DATA_ALIGN(offset, uint64_t(obj->getPageSize()));
+	DK_DEBUG_SIZE_ALIGN(size, uint64_t(obj->getPageSize()));
+	DK_DEBUG_DATA_ALIGN(memOffset, obj->getPageSize());
+	DK_DEBUG_BAD_INPUT(offset + size > uint64_t(obj->getNumPages()) * obj->getPageSize(), "range out of bounds");
+	DK_DEBUG_BAD_INPUT(uint64_t(memOffset) + size > memBlock->getSize(), "memory block range out of bounds");
+
+	return obj->commit(offset, size, memBlock, memOffset);
+}
+
+void dkSparseImageDecommit(DkSparseImage obj, uint64_t offset, uint64_t size)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_DATA_ALIGN(offset, uint64_t(obj->getPageSize()));
+	DK_DEBUG_SIZE_ALIGN(size, uint64_t(obj->getPageSize()));
+	DK_DEBUG_BAD_INPUT(offset + size > uint64_t(obj->getNumPages()) * obj->getPageSize(), "range out of bounds");
+
+	obj->decommit(offset, size);
+}
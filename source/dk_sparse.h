@@ -0,0 +1,48 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_image.h"
+
+namespace dk::detail
+{
+
+class SparseImage : public ObjBase
+{
+	Mutex m_mutex;
+	ImageLayout m_layout;
+	DkGpuAddr m_iova;
+	uint32_t m_numPages;
+	uint32_t* m_pageMap; // bitmap of the pages that are currently backed by memory
+
+	constexpr bool isPageMapped(uint32_t page) const noexcept
+	{
+		return (m_pageMap[page / 32] >> (page % 32)) & 1;
+	}
+
+	constexpr void setPageMapped(uint32_t page, bool mapped) noexcept
+	{
+		if (mapped)
+			m_pageMap[page / 32] |= 1U << (page % 32);
+		else
+			m_pageMap[page / 32] &= ~(1U << (page % 32));
+	}
+
+	void unmapPage(uint32_t page) noexcept;
+
+public:
+	constexpr SparseImage(DkSparseImageMaker const& m) noexcept : ObjBase{m.device},
+		m_mutex{}, m_layout{*m.layout}, m_iova{DK_GPU_ADDR_INVALID}, m_numPages{}, m_pageMap{} { }
+	~SparseImage() { destroy(); }
+
+	DkResult initialize() noexcept;
+	void destroy();
+
+	constexpr ImageLayout const& getLayout() const noexcept { return m_layout; }
+	constexpr DkGpuAddr getGpuAddr() const noexcept { return m_iova; }
+	constexpr uint32_t getNumPages() const noexcept { return m_numPages; }
+	uint32_t getPageSize() const noexcept;
+
+	DkResult commit(uint64_t offset, uint64_t size, DkMemBlock memBlock, uint32_t memOffset) noexcept;
+	void decommit(uint64_t offset, uint64_t size) noexcept;
+};
+
+}
@@ -0,0 +1,55 @@
+#include "layoutcache.h"
+
+using namespace dk::detail;
+
+ImageLayoutCache::Key ImageLayoutCache::makeKey(DkImageLayoutMaker const& maker)
+{
+	Key key = {};
+	key.m_type = maker.type;
+	key.m_flags = maker.flags;
+	key.m_format = maker.format;
+	key.m_msMode = maker.msMode;
+	key.m_dimensions[0] = maker.dimensions[0];
+	key.m_dimensions[1] = maker.dimensions[1];
+	key.m_dimensions[2] = maker.dimensions[2];
+	key.m_mipLevels = maker.mipLevels;
+	key.m_tileSize = (maker.flags & DkImageFlags_CustomTileSize) ? maker.tileSize : 0;
+	return key;
+}
+
+uint32_t ImageLayoutCache::hashKey(Key const& key)
+{
+	// FNV-1a over the key words, folded down to the table size
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+	uint32_t hash = 2166136261U;
+	for (unsigned i = 0; i < sizeof(Key)/sizeof(uint32_t); i ++)
+	{
+		hash ^= words[i];
+		hash *= 16777619U;
+	}
+	return (hash ^ (hash >> 16)) & (s_numEntries - 1);
+}
+
+bool ImageLayoutCache::lookup(DkImageLayoutMaker const& maker, ImageLayout& out)
+{
+	Key key = makeKey(maker);
+	Entry& entry = m_entries[hashKey(key)];
+
+	MutexHolder m{m_mutex};
+	if (!entry.m_valid || !(entry.m_key == key))
+		return false;
+
+	out = entry.m_layout;
+	return true;
+}
+
+void ImageLayoutCache::insert(DkImageLayoutMaker const& maker, ImageLayout const& layout)
+{
+	Key key = makeKey(maker);
+	Entry& entry = m_entries[hashKey(key)];
+
+	MutexHolder m{m_mutex};
+	entry.m_key = key;
+	entry.m_valid = true;
+	entry.m_layout = layout;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "dk_private.h"
+#include "dk_image.h"
+
+namespace dk::detail
+{
+	// Direct-mapped cache of block linear image layouts, indexed by a hash of the
+	// layout maker parameters. Colliding makers simply evict each other.
+	class ImageLayoutCache : public ObjBase
+	{
+	public:
+		static constexpr unsigned s_numEntriesLog2 = 6;
+		static constexpr unsigned s_numEntries = 1U << s_numEntriesLog2;
+
+	private:
+		struct Key
+		{
+			uint32_t m_type;
+			uint32_t m_flags;
+			uint32_t m_format;
+			uint32_t m_msMode;
+			uint32_t m_dimensions[3];
+			uint32_t m_mipLevels;
+			uint32_t m_tileSize;
+
+			bool operator==(Key const& rhs) const noexcept
+			{
+				return memcmp(this, &rhs, sizeof(Key)) == 0;
+			}
+		};
+
+		struct Entry
+		{
+			Key m_key;
+			bool m_valid;
+			ImageLayout m_layout;
+		};
+
+		Mutex m_mutex;
+		Entry m_entries[s_numEntries];
+
+		static Key makeKey(DkImageLayoutMaker const& maker) noexcept;
+		static uint32_t hashKey(Key const& key) noexcept;
+
+	public:
+		constexpr ImageLayoutCache(DkDevice device) noexcept : ObjBase{device},
+			m_mutex{}, m_entries{} { }
+
+		void* operator new(size_t, void* p) noexcept { return p; }
+
+		bool lookup(DkImageLayoutMaker const& maker, ImageLayout& out) noexcept;
+		void insert(DkImageLayoutMaker const& maker, ImageLayout const& layout) noexcept;
+	};
+}
@@ -1,4 +1,5 @@
 #include "../dk_queue.h"
+#include "../dk_bindless_table.h"
 #include "../cmdbuf_writer.h"
 
 #include "mme_macros.h"
@@ -164,3 +165,52 @@ void dkCmdBufPushConstants(DkCmdBuf obj, DkGpuAddr uboAddr, uint32_t uboSize, ui
 	w << CmdList<1>{ MakeCmdHeader(NonIncreasing, sizeWords, Subchannel3D, Engine3D::LoadConstbufData{}) };
 	w.addRawData(data, size);
 }
+
+void BindlessTable::flush(DkCmdBuf cmdbuf)
+{
+	MutexHolder m{m_mutex};
+	if (!m_numDirty)
+		return;
+
+	// Upload each run of dirty descriptors in-band, so that the updates are ordered
+	// with respect to the surrounding rendering work, and only invalidate the cache
+	// lines that actually changed (unless there are too many of them)
+	using ITHC = Engine3D::InvalidateTextureHeaderCacheNoWfi;
+	DkGpuAddr gpuAddr = getGpuAddr();
+	bool perLine = m_numDirty <= s_maxLineInvalidations;
+	for (uint32_t id = m_dirtyBegin; id < m_dirtyEnd;)
+	{
+		if (!isDirty(id))
+		{
+			// Skip clean words of the mask in one go
+			id = (id % 32) == 0 && !m_dirtyMask[id/32] ? id + 32 : id + 1;
+			continue;
+		}
+
+		uint32_t end = id + 1;
+		while (end < m_dirtyEnd && end - id < s_maxPushDescriptors && isDirty(end))
+			end ++;
+
+		dkCmdBufPushData(cmdbuf, gpuAddr + id*s_descriptorSize, &m_descriptors[id], (end - id)*s_descriptorSize);
+		if (perLine)
+		{
+			CmdBufWriter w{cmdbuf};
+			w.reserve(2*(end - id));
+			for (uint32_t i = id; i < end; i ++)
+				w << Cmd(3D, InvalidateTextureHeaderCacheNoWfi{}, ITHC::Lines::One | ITHC::Tag{i});
+		}
+
+		id = end;
+	}
+
+	if (!perLine)
+	{
+		CmdBufWriter w{cmdbuf};
+		w.reserve(1);
+		w << CmdInline(3D, InvalidateTextureHeaderCacheNoWfi{}, ITHC::Lines::All);
+	}
+
+	memset(&m_dirtyMask[m_dirtyBegin/32], 0, ((m_dirtyEnd + 31)/32 - m_dirtyBegin/32)*sizeof(uint32_t));
+	m_numDirty = 0;
+	m_dirtyBegin = m_dirtyEnd = 0;
+}
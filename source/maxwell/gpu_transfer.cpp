@@ -25,58 +25,74 @@ void Queue::setupTransfer()
 	w << CmdInline(2D, SetPixelsFromMemoryCorralSize{}, 0x3f);
 }
 
-void dk::detail::BlitCopyEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo const& dst, BlitParams const& params, uint32_t srcZ, uint32_t dstZ)
+namespace
 {
-	CmdBufWriter w{obj};
-	w.reserve(2*7 + 4 + 10);
-
-	DkGpuAddr srcIova = src.m_iova;
-	DkGpuAddr dstIova = dst.m_iova;
-	uint32_t copyFlags = Copy::LaunchDma::TransferType::NonPipelined | Copy::LaunchDma::FlushEnable{} | Copy::LaunchDma::MultiLineEnable{};
-	bool useSwizzle = false;
+	struct CopySurface
+	{
+		DkGpuAddr iova;
+		uint32_t layer;
+		uint32_t x, y;
+	};
+
+	// Works out where a piece of a transfer starts within a surface. Block linear
+	// X origins are given in units of horizFactor bytes (1 while remapping, since
+	// the remapping unit works with whole texels).
+	CopySurface planSurface(ImageInfo const& info, uint32_t x, uint32_t y, uint32_t z, uint32_t horizFactor)
+	{
+		CopySurface out = { info.m_iova, 0, 0, 0 };
+		if (info.m_isLayered)
+			out.iova += z * info.m_layerStride;
 
-	if (src.m_isLayered)
-		srcIova += srcZ * src.m_layerStride;
-	if (src.m_isLinear)
-		srcIova += params.srcY * src.m_horizontal + params.srcX * src.m_bytesPerBlock;
-	else if (src.m_widthMs * src.m_bytesPerBlock > 0x10000)
-		useSwizzle = true;
+		if (info.m_isLinear)
+			out.iova += int64_t(int32_t(info.m_horizontal)) * y + x * info.m_bytesPerBlock; // pitch may be negative (flipped copies)
+		else
+		{
+			if (!info.m_isLayered)
+				out.layer = z;
+			out.x = x * horizFactor;
+			out.y = y;
+		}
 
-	if (dst.m_isLayered)
-		dstIova += dstZ * dst.m_layerStride;
-	if (dst.m_isLinear)
-		dstIova += params.dstY * dst.m_horizontal + params.dstX * dst.m_bytesPerBlock;
-	else if (dst.m_widthMs * dst.m_bytesPerBlock > 0x10000)
-		useSwizzle = true;
-
-	uint32_t srcHorizFactor = 1;
-	uint32_t dstHorizFactor = 1;
-	uint32_t srcX = params.srcX;
-	uint32_t dstX = params.dstX;
-	uint32_t width = params.width;
-
-	if (!useSwizzle)
-	{
-		srcX *= src.m_bytesPerBlock;
-		dstX *= dst.m_bytesPerBlock;
-		width *= src.m_bytesPerBlock;
-		srcHorizFactor = src.m_bytesPerBlock;
-		dstHorizFactor = dst.m_bytesPerBlock;
+		return out;
 	}
 
+	// Component selectors for SetRemapComponents (besides the source components 0..3)
+	constexpr uint32_t RemapConstA  = 4;
+	constexpr uint32_t RemapNoWrite = 6;
+}
+
+void dk::detail::BlitCopyEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo const& dst, BlitParams const& params, uint32_t srcZ, uint32_t dstZ, uint32_t depth, int32_t srcZStep)
+{
+	if (!params.width || !params.height)
+		return;
+
+	CmdBufWriter w{obj};
+	w.reserve(2*5 + 4);
+
+	using E = Copy::LaunchDma;
+	uint32_t copyFlags = E::TransferType::NonPipelined | E::FlushEnable{} | E::MultiLineEnable{};
+
+	// Block linear surfaces wider than the engine can address in bytes are copied through
+	// the remapping unit instead, which measures widths and origins in whole texels
+	const bool useRemap =
+		(!src.m_isLinear && src.m_horizontal * src.m_bytesPerBlock > CopyMaxLineLength) ||
+		(!dst.m_isLinear && dst.m_horizontal * dst.m_bytesPerBlock > CopyMaxLineLength);
+	const uint32_t srcHorizFactor = useRemap ? 1 : src.m_bytesPerBlock;
+	const uint32_t dstHorizFactor = useRemap ? 1 : dst.m_bytesPerBlock;
+
+	// Surface setup is shared by every piece of the transfer, only
+	// the layer and origin registers are programmed later on.
 	if (!src.m_isLinear)
 	{
 		w << Cmd(Copy, SetSrcBlockSize{},
 			src.m_tileMode | Copy::SetSrcBlockSize::GobHeight::Fermi8,
 			src.m_horizontal*srcHorizFactor,
 			src.m_vertical,
-			src.m_depth,
-			src.m_isLayered ? 0 : srcZ,
-			Copy::SetSrcOrigin::X{srcX} | Copy::SetSrcOrigin::Y{params.srcY});
+			src.m_depth);
 	}
 	else
 	{
-		copyFlags |= Copy::LaunchDma::SrcMemoryLayout::Pitch;
+		copyFlags |= E::SrcMemoryLayout::Pitch;
 		w << Cmd(Copy, PitchIn{}, src.m_horizontal);
 	}
 
@@ -86,34 +102,133 @@ void dk::detail::BlitCopyEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo co
 			dst.m_tileMode | Copy::SetDstBlockSize::GobHeight::Fermi8,
 			dst.m_horizontal*dstHorizFactor,
 			dst.m_vertical,
-			dst.m_depth,
-			dst.m_isLayered ? 0 : dstZ,
-			Copy::SetDstOrigin::X{dstX} | Copy::SetDstOrigin::Y{params.dstY});
+			dst.m_depth);
 	}
 	else
 	{
-		copyFlags |= Copy::LaunchDma::DstMemoryLayout::Pitch;
+		copyFlags |= E::DstMemoryLayout::Pitch;
 		w << Cmd(Copy, PitchOut{}, dst.m_horizontal);
 	}
 
-	if (useSwizzle)
+	if (useRemap)
 	{
-		copyFlags |= Copy::LaunchDma::RemapEnable{};
-		uint32_t compSize = 2;
-		if (src.m_bytesPerBlock == 4 || src.m_bytesPerBlock == 8 || src.m_bytesPerBlock == 16)
-			compSize = 4;
+		// Texels are moved as up to four components of 1, 2 or 4 bytes each
+		const uint32_t bpb = src.m_bytesPerBlock;
+		const uint32_t compSize = !(bpb & 3) ? 4 : !(bpb & 1) ? 2 : 1;
 
 		using S = Copy::SetRemapComponents;
+		copyFlags |= E::RemapEnable{};
 		w << Cmd(Copy, SetRemapConst{}, 0, 0,
 			S::DstX{0} | S::DstY{1} | S::DstZ{2} | S::DstW{3} |
 			S::ComponentSize{compSize-1} |
-			S::NumSrcComponents{src.m_bytesPerBlock/compSize-1} |
+			S::NumSrcComponents{bpb/compSize-1} |
 			S::NumDstComponents{dst.m_bytesPerBlock/compSize-1});
 	}
 
-	w << Cmd(Copy, OffsetIn{}, Iova(srcIova), Iova(dstIova));
-	w << Cmd(Copy, LineLengthIn{}, width, params.height);
-	w << Cmd(Copy, LaunchDma{}, copyFlags);
+	// Split the transfer into bands of lines no bigger than CopyMaxPieceSize, giving
+	// the engine a chance to service other work in between. Only the registers that
+	// actually change are reprogrammed between pieces.
+	const uint32_t width = params.width * srcHorizFactor;
+	uint32_t bandHeight = CopyMaxPieceSize / (params.width * src.m_bytesPerBlock);
+	if (!bandHeight)
+		bandHeight = 1;
+
+	bool first = true;
+	CopySurface lastSrc = {}, lastDst = {};
+	uint32_t lastHeight = 0;
+	for (uint32_t z = 0; z < depth; z ++, srcZ += srcZStep, dstZ ++)
+	{
+		for (uint32_t y = 0; y < params.height; y += bandHeight)
+		{
+			uint32_t height = params.height - y < bandHeight ? params.height - y : bandHeight;
+			CopySurface srcSurf = planSurface(src, params.srcX, params.srcY + y, srcZ, srcHorizFactor);
+			CopySurface dstSurf = planSurface(dst, params.dstX, params.dstY + y, dstZ, dstHorizFactor);
+
+			w.reserve(2*3 + 5 + 3 + 1);
+			if (!src.m_isLinear && (first || srcSurf.layer != lastSrc.layer || srcSurf.x != lastSrc.x || srcSurf.y != lastSrc.y))
+				w << Cmd(Copy, SetSrcLayer{}, srcSurf.layer, Copy::SetSrcOrigin::X{srcSurf.x} | Copy::SetSrcOrigin::Y{srcSurf.y});
+			if (!dst.m_isLinear && (first || dstSurf.layer != lastDst.layer || dstSurf.x != lastDst.x || dstSurf.y != lastDst.y))
+				w << Cmd(Copy, SetDstLayer{}, dstSurf.layer, Copy::SetDstOrigin::X{dstSurf.x} | Copy::SetDstOrigin::Y{dstSurf.y});
+			if (first || srcSurf.iova != lastSrc.iova || dstSurf.iova != lastDst.iova)
+				w << Cmd(Copy, OffsetIn{}, Iova(srcSurf.iova), Iova(dstSurf.iova));
+			if (first || height != lastHeight)
+				w << Cmd(Copy, LineLengthIn{}, width, height);
+			w << CmdInline(Copy, LaunchDma{}, copyFlags);
+
+			first = false;
+			lastSrc = srcSurf;
+			lastDst = dstSurf;
+			lastHeight = height;
+		}
+	}
+}
+
+void dk::detail::CopyEngineBufferToImage(DkCmdBuf obj, DkGpuAddr srcIova, uint32_t srcPitch, ImageInfo const& dst, BlitParams const& params, uint32_t dstZ, CopyDstState& state)
+{
+	if (dst.m_isLinear || dst.m_horizontal * dst.m_bytesPerBlock > CopyMaxLineLength ||
+		params.width * params.height * dst.m_bytesPerBlock > CopyMaxPieceSize)
+	{
+		// Uncommon cases are handled by the generic path, which programs everything from scratch
+		// and splits the transfer into pieces as needed
+		ImageInfo src = {};
+		src.m_iova = srcIova;
+		src.m_horizontal = srcPitch;
+		src.m_bytesPerBlock = dst.m_bytesPerBlock;
+		src.m_isLinear = true;
+
+		BlitParams srcParams = params;
+		srcParams.srcX = 0;
+		srcParams.srcY = 0;
+		BlitCopyEngine(obj, src, dst, srcParams, 0, dstZ);
+		state.m_iova = DK_GPU_ADDR_INVALID;
+		return;
+	}
+
+	CmdBufWriter w{obj};
+	w.reserve(7 + 2*2 + 6 + 3 + 1);
+
+	DkGpuAddr dstIova = dst.m_iova;
+	uint32_t layer = dstZ;
+	if (dst.m_isLayered)
+	{
+		dstIova += dstZ * dst.m_layerStride;
+		layer = 0;
+	}
+
+	uint32_t origin = Copy::SetDstOrigin::X{params.dstX * dst.m_bytesPerBlock} | Copy::SetDstOrigin::Y{params.dstY};
+	if (state.m_iova != dst.m_iova)
+	{
+		w << Cmd(Copy, SetDstBlockSize{},
+			dst.m_tileMode | Copy::SetDstBlockSize::GobHeight::Fermi8,
+			dst.m_horizontal*dst.m_bytesPerBlock,
+			dst.m_vertical,
+			dst.m_depth,
+			layer,
+			origin);
+		state.m_iova = dst.m_iova;
+		state.m_layer = layer;
+		state.m_origin = origin;
+	}
+	else
+	{
+		if (state.m_layer != layer)
+		{
+			w << Cmd(Copy, SetDstLayer{}, layer);
+			state.m_layer = layer;
+		}
+		if (state.m_origin != origin)
+		{
+			w << Cmd(Copy, SetDstOrigin{}, origin);
+			state.m_origin = origin;
+		}
+	}
+
+	using E = Copy::LaunchDma;
+	w << Cmd(Copy, OffsetIn{}, Iova(srcIova), Iova(dstIova), srcPitch);
+	w << Cmd(Copy, LineLengthIn{}, params.width * dst.m_bytesPerBlock, params.height);
+	w << CmdInline(Copy, LaunchDma{},
+		E::TransferType::NonPipelined | E::FlushEnable{} | E::MultiLineEnable{} | E::SrcMemoryLayout::Pitch
+	);
 }
 
 void dk::detail::Blit2DEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo const& dst, BlitParams const& params, int32_t dudx, int32_t dvdy, uint32_t flags, uint32_t factor)
@@ -123,7 +238,6 @@ void dk::detail::Blit2DEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo cons
 
 	if (flags & Blit2D_SetupEngine)
 	{
-		using ML = E2D::SetDstMemoryLayout;
 		using BO = E2D::SetOperation;
 		uint32_t blitOp;
 		bool hasFactor = false;
@@ -152,7 +266,12 @@ void dk::detail::Blit2DEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo cons
 		w << CmdInline(2D, SetOperation{}, blitOp);
 		if (hasFactor)
 			w << Cmd(2D, SetBeta4{}, factor); // premult blend factor
+		w << CmdInline(2D, SetCompressionEnable{}, 1);
+	}
 
+	if (flags & (Blit2D_SetupEngine | Blit2D_SetupSurfaces))
+	{
+		using ML = E2D::SetDstMemoryLayout;
 		if (!src.m_isLinear)
 		{
 			w << Cmd(2D, SetSrcFormat{}, src.m_format, ML::BlockLinear, src.m_tileMode, src.m_arrayMode);
@@ -174,8 +293,6 @@ void dk::detail::Blit2DEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo cons
 			w << Cmd(2D, SetDstFormat{}, dst.m_format, ML::Pitch);
 			w << Cmd(2D, SetDstPitch{}, dst.m_horizontal, dst.m_width, dst.m_height, Iova(dst.m_iova));
 		}
-
-		w << CmdInline(2D, SetCompressionEnable{}, 1);
 	}
 	else
 	{
@@ -207,6 +324,156 @@ void dk::detail::Blit2DEngine(DkCmdBuf obj, ImageInfo const& src, ImageInfo cons
 	);
 }
 
+void dk::detail::FillCopyEngine(DkCmdBuf obj, ImageInfo const& dst, BlitParams const& params, uint32_t dstZ, uint32_t depth, const void* value)
+{
+	if (!params.width || !params.height)
+		return;
+
+	// Texels are split into up to four components of 1, 2 or 4 bytes each,
+	// which the remapping unit then fills in from its two constants
+	const uint32_t bpb = dst.m_bytesPerBlock;
+	const uint32_t compSize = !(bpb & 3) ? 4 : !(bpb & 1) ? 2 : 1;
+	const uint32_t numComps = bpb / compSize;
+	uint32_t comps[4] = {};
+	for (uint32_t i = 0; i < numComps; i ++)
+		memcpy(&comps[i], static_cast<const uint8_t*>(value) + i*compSize, compSize);
+
+	CmdBufWriter w{obj};
+	w.reserve(2 + 5);
+
+	// The source is never read, but with multiple lines its pitch is still
+	// used for addressing, so don't leave it to whatever the last copy set
+	using E = Copy::LaunchDma;
+	uint32_t copyFlags = E::TransferType::NonPipelined | E::FlushEnable{} | E::MultiLineEnable{} | E::RemapEnable{} | E::SrcMemoryLayout::Pitch;
+	w << Cmd(Copy, PitchIn{}, dst.m_isLinear ? dst.m_horizontal : params.width * bpb);
+
+	// While remapping, surface widths, origins and line lengths are expressed in texels
+	if (!dst.m_isLinear)
+	{
+		w << Cmd(Copy, SetDstBlockSize{},
+			dst.m_tileMode | Copy::SetDstBlockSize::GobHeight::Fermi8,
+			dst.m_horizontal,
+			dst.m_vertical,
+			dst.m_depth);
+	}
+	else
+	{
+		copyFlags |= E::DstMemoryLayout::Pitch;
+		w << Cmd(Copy, PitchOut{}, dst.m_horizontal);
+	}
+
+	uint32_t bandHeight = CopyMaxPieceSize / (params.width * bpb);
+	if (!bandHeight)
+		bandHeight = 1;
+
+	// Texels made out of more than two distinct component values need additional
+	// passes, each of which leaves the components it doesn't handle untouched
+	uint32_t pending = (1U << numComps) - 1;
+	while (pending)
+	{
+		uint32_t consts[2] = {};
+		uint32_t numConsts = 0;
+		uint32_t sel[4];
+		for (uint32_t i = 0; i < 4; i ++)
+		{
+			sel[i] = RemapNoWrite;
+			if (!(pending & (1U << i)))
+				continue;
+
+			uint32_t j;
+			for (j = 0; j < numConsts && consts[j] != comps[i]; j ++);
+			if (j == numConsts && numConsts < 2)
+				consts[numConsts++] = comps[i];
+			if (j < numConsts)
+			{
+				sel[i] = RemapConstA + j;
+				pending &= ~(1U << i);
+			}
+		}
+
+		using S = Copy::SetRemapComponents;
+		w.reserve(4);
+		w << Cmd(Copy, SetRemapConst{}, consts[0], consts[1],
+			S::DstX{sel[0]} | S::DstY{sel[1]} | S::DstZ{sel[2]} | S::DstW{sel[3]} |
+			S::ComponentSize{compSize-1} |
+			S::NumSrcComponents{numComps-1} |
+			S::NumDstComponents{numComps-1});
+
+		for (uint32_t z = 0; z < depth; z ++)
+		{
+			DkGpuAddr iova = dst.m_iova;
+			uint32_t layer = dstZ + z;
+			if (dst.m_isLayered)
+			{
+				iova += uint64_t(layer) * dst.m_layerStride;
+				layer = 0;
+			}
+
+			for (uint32_t y = 0; y < params.height; y += bandHeight)
+			{
+				uint32_t height = params.height - y < bandHeight ? params.height - y : bandHeight;
+				DkGpuAddr lineIova = iova;
+
+				w.reserve(3 + 3 + 3 + 1);
+				if (dst.m_isLinear)
+					lineIova += uint64_t(params.dstY + y) * dst.m_horizontal + params.dstX * bpb;
+				else
+					w << Cmd(Copy, SetDstLayer{}, layer, Copy::SetDstOrigin::X{params.dstX} | Copy::SetDstOrigin::Y{params.dstY + y});
+
+				// Nothing is read from the source, but it still needs to point somewhere valid
+				w << Cmd(Copy, OffsetIn{}, Iova(lineIova), Iova(lineIova));
+				w << Cmd(Copy, LineLengthIn{}, params.width, height);
+				w << CmdInline(Copy, LaunchDma{}, copyFlags);
+			}
+		}
+	}
+}
+
+void dk::detail::Fill2DEngine(DkCmdBuf obj, ImageInfo const& dst, BlitParams const& params, const void* value, bool setup)
+{
+	// The solid color register holds a single texel of at most 32 bits in the dst format,
+	// wider texels need to go through the copy engine instead
+	DK_DEBUG_BAD_INPUT(dst.m_bytesPerBlock > 4, "format too wide for the 2D engine");
+	if (dst.m_bytesPerBlock > 4)
+		return;
+
+	uint32_t color = 0;
+	memcpy(&color, value, dst.m_bytesPerBlock);
+
+	CmdBufWriter w{obj};
+	w.reserve(3 + 7 + 3 + 5);
+
+	if (setup)
+	{
+		using ML = E2D::SetDstMemoryLayout;
+		w << CmdInline(2D, SetOperation{}, E2D::SetOperation::SrcCopy);
+		w << CmdInline(2D, SetCompressionEnable{}, 1);
+		if (!dst.m_isLinear)
+		{
+			w << Cmd(2D, SetDstFormat{}, dst.m_format, ML::BlockLinear, dst.m_tileMode, dst.m_arrayMode, 0);
+			w << Cmd(2D, SetDstWidth{}, dst.m_horizontal, dst.m_vertical, Iova(dst.m_iova));
+		}
+		else
+		{
+			w << Cmd(2D, SetDstFormat{}, dst.m_format, ML::Pitch);
+			w << Cmd(2D, SetDstPitch{}, dst.m_horizontal, dst.m_width, dst.m_height, Iova(dst.m_iova));
+		}
+
+		w << CmdInline(2D, RenderSolidPrimMode{}, E2D::RenderSolidPrimMode::Rects);
+		w << Cmd(2D, SetRenderSolidPrimColorFormat{}, dst.m_format, color);
+	}
+	else
+		w << Cmd(2D, SetDstOffset{}, Iova(dst.m_iova));
+
+	// Rectangles are given by two corners, the second one being exclusive
+	w << Cmd(2D, RenderSolidPrimPoint{},
+		params.dstX,
+		params.dstY,
+		params.dstX + params.width,
+		params.dstY + params.height
+	);
+}
+
 void dkCmdBufPushData(DkCmdBuf obj, DkGpuAddr addr, const void* data, uint32_t size)
 {
 	DK_ENTRYPOINT(obj);
@@ -264,3 +531,40 @@ void dkCmdBufCopyBuffer(DkCmdBuf obj, DkGpuAddr srcAddr, DkGpuAddr dstAddr, uint
 
 	w << CmdInline(3D, NoOperation{}, 0);
 }
+
+void dkCmdBufFillBuffer(DkCmdBuf obj, DkGpuAddr addr, uint32_t size, uint32_t value)
+{
+	DK_ENTRYPOINT(obj);
+	DK_DEBUG_BAD_INPUT(addr == DK_GPU_ADDR_INVALID);
+	DK_DEBUG_DATA_ALIGN(addr, 4);
+	DK_DEBUG_SIZE_ALIGN(size, 4);
+	if (!size)
+		return;
+
+	CmdBufWriter w{obj};
+
+	// The buffer is treated as a line of 32-bit elements, all taken from the first remap constant
+	using S = Copy::SetRemapComponents;
+	w.reserve(2 + 4); // one more for extra flush
+	w << CmdInline(3D, NoOperation{}, 0);
+	w << Cmd(Copy, SetRemapConst{}, value, value,
+		S::DstX{RemapConstA} | S::ComponentSize::Four | S::NumSrcComponents::One | S::NumDstComponents::One);
+
+	while (size)
+	{
+		uint32_t curSize = size > CopyMaxPieceSize ? CopyMaxPieceSize : size;
+
+		using E = Copy::LaunchDma;
+		w.reserve(9); // one more for extra flush
+		w << Cmd(Copy, OffsetIn{}, Iova(addr), Iova(addr));
+		w << Cmd(Copy, LineLengthIn{}, curSize / 4);
+		w << CmdInline(Copy, LaunchDma{},
+			E::TransferType::NonPipelined | E::FlushEnable{} | E::RemapEnable{} | E::SrcMemoryLayout::Pitch | E::DstMemoryLayout::Pitch
+		);
+
+		size -= curSize;
+		addr += curSize;
+	}
+
+	w << CmdInline(3D, NoOperation{}, 0);
+}
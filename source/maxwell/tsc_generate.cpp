@@ -50,53 +50,76 @@ namespace
 
 		return roundToInt(s * 255.0f);
 	}
+
+	// As with image descriptors, the descriptor is assembled locally and then written out in one go
+	void buildDescriptor(SamplerDescriptor* out, DkSampler const* sampler)
+	{
+		SamplerDescriptor desc = {};
+		SamplerDescriptor* obj = &desc;
+
+		unsigned lodSnap;
+		for (lodSnap = 0; lodSnap < 0x20; lodSnap ++)
+			if ((-lodSnapTable[lodSnap]) >= sampler->lodSnap)
+				break;
+		if (lodSnap == 0x20)
+			lodSnap = 0x1F;
+
+		float lodClampMin = clamp(sampler->lodClampMin, 0.0f, 15.0f);
+		float lodClampMax = clamp(sampler->lodClampMax, 0.0f, 15.0f);
+		if (lodClampMax < lodClampMin)
+			lodClampMax = lodClampMin;
+
+		obj->address_u = sampler->wrapMode[0];
+		obj->address_v = sampler->wrapMode[1];
+		obj->address_p = sampler->wrapMode[2];
+		obj->depth_compare = sampler->compareEnable;
+		obj->depth_compare_op = (unsigned)sampler->compareOp - 1;
+		obj->srgb_conversion = 1;
+		obj->font_filter_width = 1;
+		obj->font_filter_height = 1;
+		obj->max_anisotropy = anisoTable[roundToInt(clamp(sampler->maxAnisotropy, 1.0f, 16.0f))-1];
+
+		obj->mag_filter = sampler->magFilter;
+		obj->min_filter = sampler->minFilter;
+		obj->mip_filter = sampler->mipFilter;
+		obj->cubemap_anisotropy = 1;
+		obj->cubemap_interface_filtering = 1;
+		obj->reduction_filter = sampler->reductionMode;
+		obj->mip_lod_bias = floatToFixed<signed>(clamp(lodSnapTable[lodSnap] + sampler->lodBias, -15.0f, +15.0f), 8);
+		obj->float_coord_normalization = 0;
+		obj->trilin_opt = lodSnap;
+
+		obj->min_lod_clamp = floatToFixed(lodClampMin, 8);
+		obj->max_lod_clamp = floatToFixed(lodClampMax, 8);
+		obj->srgb_border_color_r = floatToSrgb8(sampler->borderColor[0].value_f);
+
+		obj->srgb_border_color_g = floatToSrgb8(sampler->borderColor[1].value_f);
+		obj->srgb_border_color_b = floatToSrgb8(sampler->borderColor[2].value_f);
+
+		obj->border_color_r = sampler->borderColor[0].value_ui;
+		obj->border_color_g = sampler->borderColor[1].value_ui;
+		obj->border_color_b = sampler->borderColor[2].value_ui;
+		obj->border_color_a = sampler->borderColor[3].value_ui;
+
+		*out = desc;
+	}
 }
 
 void dkSamplerDescriptorInitialize(DkSamplerDescriptor* obj, DkSampler const* sampler)
 {
-	memset(obj, 0, sizeof(*obj));
-
-	unsigned lodSnap;
-	for (lodSnap = 0; lodSnap < 0x20; lodSnap ++)
-		if ((-lodSnapTable[lodSnap]) >= sampler->lodSnap)
-			break;
-	if (lodSnap == 0x20)
-		lodSnap = 0x1F;
-
-	float lodClampMin = clamp(sampler->lodClampMin, 0.0f, 15.0f);
-	float lodClampMax = clamp(sampler->lodClampMax, 0.0f, 15.0f);
-	if (lodClampMax < lodClampMin)
-		lodClampMax = lodClampMin;
-
-	obj->address_u = sampler->wrapMode[0];
-	obj->address_v = sampler->wrapMode[1];
-	obj->address_p = sampler->wrapMode[2];
-	obj->depth_compare = sampler->compareEnable;
-	obj->depth_compare_op = (unsigned)sampler->compareOp - 1;
-	obj->srgb_conversion = 1;
-	obj->font_filter_width = 1;
-	obj->font_filter_height = 1;
-	obj->max_anisotropy = anisoTable[roundToInt(clamp(sampler->maxAnisotropy, 1.0f, 16.0f))-1];
-
-	obj->mag_filter = sampler->magFilter;
-	obj->min_filter = sampler->minFilter;
-	obj->mip_filter = sampler->mipFilter;
-	obj->cubemap_anisotropy = 1;
-	obj->cubemap_interface_filtering = 1;
-	obj->reduction_filter = sampler->reductionMode;
-	obj->mip_lod_bias = floatToFixed<signed>(clamp(lodSnapTable[lodSnap] + sampler->lodBias, -15.0f, +15.0f), 8);
-	obj->float_coord_normalization = 0;
-	obj->trilin_opt = lodSnap;
-
-	obj->min_lod_clamp = floatToFixed(lodClampMin, 8);
-	obj->max_lod_clamp = floatToFixed(lodClampMax, 8);
-	obj->srgb_border_color_r = floatToSrgb8(sampler->borderColor[0].value_f);
-
-	obj->srgb_border_color_g = floatToSrgb8(sampler->borderColor[1].value_f);
-	obj->srgb_border_color_b = floatToSrgb8(sampler->borderColor[2].value_f);
-
-	obj->border_color_r = sampler->borderColor[0].value_ui;
-	obj->border_color_g = sampler->borderColor[1].value_ui;
-	obj->border_color_b = sampler->borderColor[2].value_ui;
-	obj->border_color_a = sampler->borderColor[3].value_ui;
+	buildDescriptor(obj, sampler);
+}
+
+void dkSamplerDescriptorInitializeBatch(DkSamplerDescriptor objs[], DkSampler const samplers[], uint32_t numSamplers)
+{
+	// Runs of identical samplers are common (e.g. one per material), and generating
+	// the descriptor involves some float math: reuse the last one. It is kept on the
+	// side since the destination may be uncached memory, which is slow to read back.
+	SamplerDescriptor last;
+	for (uint32_t i = 0; i < numSamplers; i ++)
+	{
+		if (!i || memcmp(&samplers[i], &samplers[i-1], sizeof(DkSampler)) != 0)
+			buildDescriptor(&last, &samplers[i]);
+		objs[i] = last;
+	}
 }
@@ -0,0 +1,95 @@
+#include "programids.h"
+
+using namespace dk::detail;
+
+namespace
+{
+	uint32_t g_programId;
+}
+
+uint32_t ProgramIdTable::newId() noexcept
+{
+	uint32_t newId;
+	uint32_t curId = __atomic_load_n(&g_programId, __ATOMIC_SEQ_CST);
+	do
+	{
+		newId = curId + 1;
+		if (newId == 0)
+			newId = 1; // roll over and skip 0
+	} while (!__atomic_compare_exchange_n(&g_programId, &curId, newId, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+	return newId;
+}
+
+void ProgramIdTable::cleanup()
+{
+	MutexHolder m{m_mutex};
+	if (m_entries)
+	{
+		freeMem(m_entries);
+		m_entries = nullptr;
+	}
+	m_mask = 0;
+	m_count = 0;
+}
+
+uint32_t ProgramIdTable::hashKey(Key const& key)
+{
+	// FNV-1a over the key words
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+	uint32_t hash = 2166136261U;
+	for (unsigned i = 0; i < sizeof(Key)/sizeof(uint32_t); i ++)
+	{
+		hash ^= words[i];
+		hash *= 16777619U;
+	}
+	return hash ^ (hash >> 16);
+}
+
+bool ProgramIdTable::grow() noexcept
+{
+	// Must be called with the mutex held
+	uint32_t newSize = m_entries ? 2*(m_mask+1) : 64;
+	Entry* newEntries = static_cast<Entry*>(allocMem(newSize*sizeof(Entry)));
+	if (!newEntries)
+		return false;
+
+	memset(newEntries, 0, newSize*sizeof(Entry));
+	if (m_entries)
+	{
+		for (uint32_t i = 0; i <= m_mask; i ++)
+		{
+			if (!m_entries[i].m_id)
+				continue;
+			uint32_t pos = hashKey(m_entries[i].m_key) & (newSize - 1);
+			while (newEntries[pos].m_id)
+				pos = (pos + 1) & (newSize - 1);
+			newEntries[pos] = m_entries[i];
+		}
+		freeMem(m_entries);
+	}
+
+	m_entries = newEntries;
+	m_mask = newSize - 1;
+	return true;
+}
+
+uint32_t ProgramIdTable::getId(Key const& key)
+{
+	uint32_t hash = hashKey(key);
+	MutexHolder m{m_mutex};
+
+	// The table is kept at most half full. Entries are never removed: they are tiny,
+	// and a program that is initialized again at the same place gets its old ID back.
+	if (2*(m_count+1) > m_mask+1 && !grow())
+		return newId(); // no memory: the program simply won't get a stable ID
+
+	uint32_t pos = hash & m_mask;
+	for (; m_entries[pos].m_id; pos = (pos + 1) & m_mask)
+		if (m_entries[pos].m_key == key)
+			return m_entries[pos].m_id;
+
+	m_entries[pos].m_key = key;
+	m_entries[pos].m_id = newId();
+	m_count ++;
+	return m_entries[pos].m_id;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+	// Hands out the program IDs used by the BindProgram macro to skip reprogramming
+	// a stage when the same program is bound again. IDs are derived from everything
+	// the macro programs for a stage (code segment offset of the entrypoint, register
+	// count and compiler constbuf placement), so that initializing a shader several
+	// times (hot reloading, recreated DkShader structs...) yields the same ID for as
+	// long as its code stays at the same place. The full key is stored, so programs
+	// whose keys merely hash the same never share an ID.
+	class ProgramIdTable : public ObjBase
+	{
+	public:
+		struct Key
+		{
+			uint32_t m_stage;
+			uint32_t m_entrypoint;
+			uint32_t m_numGprs;
+			uint32_t m_cbufSize;
+			uint32_t m_cbufIovaShift8;
+			uint32_t m_altEntrypoint;
+			uint32_t m_altNumGprs;
+
+			bool operator==(Key const& rhs) const noexcept
+			{
+				return memcmp(this, &rhs, sizeof(Key)) == 0;
+			}
+		};
+
+	private:
+		struct Entry
+		{
+			Key m_key;
+			uint32_t m_id; // zero for empty entries
+		};
+
+		Mutex m_mutex;
+		uint32_t m_mask;
+		uint32_t m_count;
+		Entry* m_entries;
+
+		static uint32_t hashKey(Key const& key) noexcept;
+		bool grow() noexcept;
+
+	public:
+		constexpr ProgramIdTable(DkDevice device) noexcept : ObjBase{device},
+			m_mutex{}, m_mask{}, m_count{}, m_entries{} { }
+
+		void cleanup() noexcept;
+
+		static uint32_t newId() noexcept;
+		uint32_t getId(Key const& key) noexcept;
+	};
+}
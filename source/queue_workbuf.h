@@ -46,7 +46,7 @@ namespace dk::detail
 			if (m_totalSize == 0)
 				return DkResult_Success; // we have no need to allocate any memory
 			return MemBlock::initialize(
-				DkMemBlockFlags_GpuCached | DkMemBlockFlags_ZeroFillInit,
+				DkMemBlockFlags_GpuCached | DkMemBlockFlags_ZeroFillInit | MemBlockFlags_QueueWorkBuf,
 				nullptr,
 				m_totalSize);
 		}
@@ -0,0 +1,146 @@
+#include "samplercache.h"
+#include "dk_descriptor_pool.h"
+#include "dk_sampler_descriptor.h"
+
+using namespace dk::detail;
+
+namespace
+{
+	uint32_t floatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+}
+
+SamplerCache::Key SamplerCache::makeKey(DkSampler const& sampler)
+{
+	// Copied field by field, so that padding in the user's struct doesn't affect the key
+	Key key = {};
+	key.m_filters[0] = sampler.minFilter;
+	key.m_filters[1] = sampler.magFilter;
+	key.m_filters[2] = sampler.mipFilter;
+	for (unsigned i = 0; i < 3; i ++)
+		key.m_wrapMode[i] = sampler.wrapMode[i];
+	key.m_lod[0] = floatBits(sampler.lodClampMin);
+	key.m_lod[1] = floatBits(sampler.lodClampMax);
+	key.m_lod[2] = floatBits(sampler.lodBias);
+	key.m_lod[3] = floatBits(sampler.lodSnap);
+	key.m_compareEnable = sampler.compareEnable;
+	key.m_compareOp = sampler.compareOp;
+	for (unsigned i = 0; i < 4; i ++)
+		key.m_borderColor[i] = sampler.borderColor[i].value_ui;
+	key.m_maxAnisotropy = floatBits(sampler.maxAnisotropy);
+	key.m_reductionMode = sampler.reductionMode;
+	return key;
+}
+
+uint32_t SamplerCache::hashKey(Key const& key)
+{
+	// FNV-1a over the key words
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+	uint32_t hash = 2166136261U;
+	for (unsigned i = 0; i < sizeof(Key)/sizeof(uint32_t); i ++)
+	{
+		hash ^= words[i];
+		hash *= 16777619U;
+	}
+	return hash ^ (hash >> 16);
+}
+
+DkResult SamplerCache::initialize()
+{
+	m_entries = static_cast<Entry*>(allocMem(s_numSamplers*sizeof(Entry)));
+	if (!m_entries)
+		return DkResult_OutOfMemory;
+	memset(m_entries, 0, s_numSamplers*sizeof(Entry));
+
+	DkDescriptorPoolMaker maker;
+	dkDescriptorPoolMakerDefaults(&maker, getDevice(), s_numSamplers);
+	m_pool = new(getDevice()) DescriptorPool(maker);
+	DkResult res = m_pool->initialize();
+	if (res != DkResult_Success)
+	{
+		delete m_pool;
+		m_pool = nullptr;
+	}
+	return res;
+}
+
+void SamplerCache::destroy()
+{
+	if (m_pool)
+	{
+		delete m_pool;
+		m_pool = nullptr;
+	}
+
+	if (m_entries)
+	{
+		freeMem(m_entries);
+		m_entries = nullptr;
+	}
+}
+
+DkGpuAddr SamplerCache::getGpuAddr() const
+{
+	return m_pool->getGpuAddr();
+}
+
+void SamplerCache::unlink(uint32_t id)
+{
+	uint32_t* link = &m_buckets[m_entries[id].m_hash & (s_numBuckets - 1)];
+	while (*link != id + 1)
+		link = &m_entries[*link - 1].m_next;
+	*link = m_entries[id].m_next;
+	m_entries[id].m_cached = false;
+}
+
+uint32_t SamplerCache::acquire(DkSampler const& sampler)
+{
+	Key key = makeKey(sampler);
+	uint32_t hash = hashKey(key);
+	uint32_t bucket = hash & (s_numBuckets - 1);
+
+	MutexHolder m{m_mutex};
+	for (uint32_t link = m_buckets[bucket]; link; link = m_entries[link - 1].m_next)
+	{
+		Entry const& e = m_entries[link - 1];
+		if (e.m_hash == hash && e.m_key == key)
+		{
+			m_pool->addRef(link - 1);
+			return link - 1;
+		}
+	}
+
+	DkSamplerDescriptor desc;
+	dkSamplerDescriptorInitialize(&desc, &sampler);
+	uint32_t id = m_pool->alloc(&desc);
+	if (id == DK_DESCRIPTOR_INVALID)
+		return id;
+
+	Entry& e = m_entries[id];
+	if (!e.m_cached)
+	{
+		e.m_key = key;
+		e.m_hash = hash;
+		e.m_next = m_buckets[bucket];
+		e.m_cached = true;
+		m_buckets[bucket] = id + 1;
+	}
+
+	return id;
+}
+
+void SamplerCache::release(uint32_t id)
+{
+	MutexHolder m{m_mutex};
+	if (m_pool->release(id) && m_entries[id].m_cached)
+		unlink(id);
+}
+
+void SamplerCache::commit(DkCmdBuf cmdbuf)
+{
+	m_pool->commit(cmdbuf);
+}
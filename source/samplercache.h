@@ -0,0 +1,70 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+	class DescriptorPool;
+
+	// Device-wide pool of sampler descriptors, indexed by the contents of the DkSampler
+	// structs that produced them. Each unique sampler is only generated and stored once,
+	// and keeps a stable index for as long as it is referenced.
+	class SamplerCache : public ObjBase
+	{
+	public:
+		// Sampler indices are 12 bits wide in texture handles
+		static constexpr uint32_t s_numSamplers = DK_NUM_CACHED_SAMPLERS;
+		static constexpr uint32_t s_numBuckets = 1U << 10;
+
+	private:
+		struct Key
+		{
+			uint32_t m_filters[3];
+			uint32_t m_wrapMode[3];
+			uint32_t m_lod[4];
+			uint32_t m_compareEnable;
+			uint32_t m_compareOp;
+			uint32_t m_borderColor[4];
+			uint32_t m_maxAnisotropy;
+			uint32_t m_reductionMode;
+
+			bool operator==(Key const& rhs) const noexcept
+			{
+				return memcmp(this, &rhs, sizeof(Key)) == 0;
+			}
+		};
+
+		// Entries are indexed by descriptor index. Distinct keys that happen to generate
+		// the same descriptor share a pool entry, but only the first one is cached.
+		struct Entry
+		{
+			Key m_key;
+			uint32_t m_hash;
+			uint32_t m_next; // next entry in the bucket plus one (zero ends the chain)
+			bool m_cached;
+		};
+
+		Mutex m_mutex;
+		DescriptorPool* m_pool;
+		Entry* m_entries;
+		uint32_t m_buckets[s_numBuckets];
+
+		static Key makeKey(DkSampler const& sampler) noexcept;
+		static uint32_t hashKey(Key const& key) noexcept;
+
+		void unlink(uint32_t id) noexcept;
+
+	public:
+		constexpr SamplerCache(DkDevice device) noexcept : ObjBase{device},
+			m_mutex{}, m_pool{}, m_entries{}, m_buckets{} { }
+		~SamplerCache() { destroy(); }
+
+		DkResult initialize() noexcept;
+		void destroy();
+
+		DkGpuAddr getGpuAddr() const noexcept;
+
+		uint32_t acquire(DkSampler const& sampler) noexcept;
+		void release(uint32_t id) noexcept;
+		void commit(DkCmdBuf cmdbuf) noexcept;
+	};
+}
@@ -0,0 +1,288 @@
+#include "slaballoc.h"
+#include "dk_device.h"
+
+using namespace dk::detail;
+
+thread_local SlabAllocator::ThreadCache SlabAllocator::s_threadCache;
+Mutex SlabAllocator::s_listMutex;
+SlabAllocator* SlabAllocator::s_liveList;
+SlabAllocator::ThreadCache* SlabAllocator::s_cacheList;
+
+namespace
+{
+	uint32_t g_slabSerial;
+}
+
+SlabAllocator::ThreadCache::~ThreadCache()
+{
+	MutexHolder m{s_listMutex};
+	drain();
+	if (m_linked)
+	{
+		if (m_prev)
+			m_prev->m_next = m_next;
+		else
+			s_cacheList = m_next;
+		if (m_next)
+			m_next->m_prev = m_prev;
+		m_linked = false;
+	}
+}
+
+void SlabAllocator::ThreadCache::bind(SlabAllocator* owner) noexcept
+{
+	MutexHolder m{s_listMutex};
+	drain();
+	m_owner = owner;
+	m_serial = owner->m_serial;
+	if (!m_linked)
+	{
+		m_prev = nullptr;
+		m_next = s_cacheList;
+		if (m_next)
+			m_next->m_prev = this;
+		s_cacheList = this;
+		m_linked = true;
+	}
+}
+
+void SlabAllocator::ThreadCache::drain() noexcept
+{
+	// Objects go back to their owner if it is still alive. Otherwise, its
+	// regions (and the cached objects along with them) are already gone.
+	SlabAllocator* owner = nullptr;
+	if (m_owner)
+		for (SlabAllocator* cur = s_liveList; cur; cur = cur->m_nextLive)
+			if (cur == m_owner && cur->m_serial == m_serial)
+			{
+				owner = cur;
+				break;
+			}
+
+	for (unsigned i = 0; i < s_numClasses; i ++)
+	{
+		uint32_t count = m_count[i];
+		if (owner && count)
+		{
+			FreeObj* last = m_head[i];
+			while (last->m_next)
+				last = last->m_next;
+			owner->pushObjects(i, m_head[i], last, count);
+		}
+		__atomic_store_n(&m_count[i], 0, __ATOMIC_RELAXED);
+		m_head[i] = nullptr;
+	}
+
+	m_owner = nullptr;
+	m_serial = 0;
+}
+
+void SlabAllocator::initialize()
+{
+	// Serial numbers are never reused, so that a thread cache left behind by a
+	// destroyed device can't be mistaken for one belonging to a newer device
+	// that happened to be allocated at the same address.
+	m_serial = __atomic_add_fetch(&g_slabSerial, 1, __ATOMIC_RELAXED);
+
+	MutexHolder m{s_listMutex};
+	m_nextLive = s_liveList;
+	s_liveList = this;
+}
+
+void SlabAllocator::cleanup()
+{
+	{
+		// Once unlisted, no thread cache can hand objects back to us anymore.
+		// Caches of other threads still bound to us drop their objects when
+		// they are next used (or when their thread exits).
+		MutexHolder m{s_listMutex};
+		for (SlabAllocator** cur = &s_liveList; *cur; cur = &(*cur)->m_nextLive)
+			if (*cur == this)
+			{
+				*cur = m_nextLive;
+				break;
+			}
+
+		ThreadCache* tc = &s_threadCache;
+		if (tc->m_owner == this && tc->m_serial == m_serial)
+			tc->drain();
+	}
+
+	MutexHolder m{m_mutex};
+	DkDeviceMaker const& maker = getDevice()->getMaker();
+	uint32_t numRegions = m_numRegions;
+	__atomic_store_n(&m_numRegions, 0, __ATOMIC_RELEASE);
+	for (uint32_t i = 0; i < numRegions; i ++)
+		maker.cbFree(maker.userData, reinterpret_cast<void*>(m_regions[i]));
+
+	m_nextPage = 0;
+	for (unsigned i = 0; i < s_numClasses; i ++)
+		m_classes[i] = {};
+}
+
+int SlabAllocator::lookupClass(const void* ptr) const noexcept
+{
+	// Regions are only ever appended (with m_numRegions being published last),
+	// so this can safely run concurrently with addPage.
+	uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+	uint32_t numRegions = __atomic_load_n(&m_numRegions, __ATOMIC_ACQUIRE);
+	for (uint32_t i = 0; i < numRegions; i ++)
+	{
+		uintptr_t offset = addr - m_regions[i];
+		if (offset < s_regionSize)
+			return m_pageClass[i][offset / s_pageSize];
+	}
+	return -1;
+}
+
+bool SlabAllocator::addPage(unsigned cls) noexcept
+{
+	// Must be called with the mutex held
+	if (!m_numRegions || m_nextPage == s_pagesPerRegion)
+	{
+		if (m_numRegions == s_maxRegions)
+			return false;
+
+		void* mem = nullptr;
+		DkDeviceMaker const& maker = getDevice()->getMaker();
+		if (maker.cbAlloc(maker.userData, s_maxObjAlign, s_regionSize, &mem) != DkResult_Success || !mem)
+			return false;
+
+		m_regions[m_numRegions] = reinterpret_cast<uintptr_t>(mem);
+		__atomic_store_n(&m_numRegions, m_numRegions+1, __ATOMIC_RELEASE);
+		m_nextPage = 0;
+	}
+
+	uint32_t region = m_numRegions - 1;
+	uint32_t page = m_nextPage++;
+	m_pageClass[region][page] = cls;
+
+	// Carve the page into objects and thread them onto the free list
+	size_t objSize = classToSize(cls);
+	uint32_t numObjs = s_pageSize / objSize;
+	char* base = reinterpret_cast<char*>(m_regions[region]) + page*s_pageSize;
+	FreeObj* first = reinterpret_cast<FreeObj*>(base);
+	FreeObj* cur = first;
+	for (uint32_t i = 1; i < numObjs; i ++)
+	{
+		FreeObj* next = reinterpret_cast<FreeObj*>(base + i*objSize);
+		cur->m_next = next;
+		cur = next;
+	}
+
+	SizeClass& c = m_classes[cls];
+	cur->m_next = c.m_freeList;
+	c.m_freeList = first;
+	c.m_numFree += numObjs;
+	c.m_numPages ++;
+	return true;
+}
+
+uint32_t SlabAllocator::popObjects(unsigned cls, FreeObj*& out, uint32_t count) noexcept
+{
+	MutexHolder m{m_mutex};
+	SizeClass& c = m_classes[cls];
+	if (!c.m_freeList && !addPage(cls))
+		return 0;
+
+	FreeObj* first = c.m_freeList;
+	FreeObj* last = first;
+	uint32_t i;
+	for (i = 1; i < count && last->m_next; i ++)
+		last = last->m_next;
+
+	c.m_freeList = last->m_next;
+	c.m_numFree -= i;
+	last->m_next = nullptr;
+	out = first;
+	return i;
+}
+
+void SlabAllocator::pushObjects(unsigned cls, FreeObj* first, FreeObj* last, uint32_t count) noexcept
+{
+	MutexHolder m{m_mutex};
+	SizeClass& c = m_classes[cls];
+	last->m_next = c.m_freeList;
+	c.m_freeList = first;
+	c.m_numFree += count;
+}
+
+void* SlabAllocator::allocObj(size_t size) noexcept
+{
+	unsigned cls = sizeToClass(size);
+	ThreadCache* tc = getThreadCache();
+	uint32_t count = tc->m_count[cls];
+
+	if (!count)
+	{
+		// Refill half of the cache in one go, so that the mutex is
+		// taken at most once every few allocations
+		count = popObjects(cls, tc->m_head[cls], s_cacheSize/2);
+		if (!count)
+			return nullptr;
+	}
+
+	// Counts are stored atomically since getStats reads them from other threads
+	FreeObj* obj = tc->m_head[cls];
+	tc->m_head[cls] = obj->m_next;
+	__atomic_store_n(&tc->m_count[cls], count - 1, __ATOMIC_RELAXED);
+	return obj;
+}
+
+bool SlabAllocator::freeObj(void* ptr) noexcept
+{
+	int cls = lookupClass(ptr);
+	if (cls < 0)
+		return false;
+
+	FreeObj* obj = static_cast<FreeObj*>(ptr);
+	ThreadCache* tc = getThreadCache();
+	uint32_t count = tc->m_count[cls];
+
+	if (count == s_cacheSize)
+	{
+		// Cache is full: give back the object along with half of the cache
+		FreeObj* last = obj;
+		last->m_next = tc->m_head[cls];
+		for (unsigned i = 0; i < s_cacheSize/2; i ++)
+			last = last->m_next;
+		tc->m_head[cls] = last->m_next;
+		__atomic_store_n(&tc->m_count[cls], count - s_cacheSize/2, __ATOMIC_RELAXED);
+		pushObjects(cls, obj, last, s_cacheSize/2 + 1);
+		return true;
+	}
+
+	obj->m_next = tc->m_head[cls];
+	tc->m_head[cls] = obj;
+	__atomic_store_n(&tc->m_count[cls], count + 1, __ATOMIC_RELAXED);
+	return true;
+}
+
+void SlabAllocator::getStats(DkSlabStats& out) noexcept
+{
+	// Objects sitting in thread caches are free, even though the shared free lists don't know about them
+	uint32_t numCached[s_numClasses] = {};
+	MutexHolder g{s_listMutex};
+	for (ThreadCache* tc = s_cacheList; tc; tc = tc->m_next)
+		if (tc->m_owner == this && tc->m_serial == m_serial)
+			for (unsigned i = 0; i < s_numClasses; i ++)
+				numCached[i] += __atomic_load_n(&tc->m_count[i], __ATOMIC_RELAXED);
+
+	MutexHolder m{m_mutex};
+	out = {};
+	out.numRegions = m_numRegions;
+	out.reservedSize = uint64_t(m_numRegions) * s_regionSize;
+	for (unsigned i = 0; i < s_numClasses; i ++)
+	{
+		SizeClass const& c = m_classes[i];
+		size_t objSize = classToSize(i);
+		uint32_t numObjs = c.m_numPages * (s_pageSize / objSize);
+		uint32_t numFree = c.m_numFree + numCached[i];
+		if (numFree > numObjs)
+			numFree = numObjs; // counts are sampled while other threads keep going
+		out.numPages += c.m_numPages;
+		out.numObjects += numObjs - numFree;
+		out.numFreeObjects += numFree;
+		out.usedSize += uint64_t(numObjs - numFree) * objSize;
+	}
+}
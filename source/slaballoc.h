@@ -0,0 +1,121 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+	class SlabAllocator : public ObjBase
+	{
+	public:
+		// Objects are grouped in power-of-two size classes (32..1024 bytes).
+		// Anything bigger (or with stricter alignment) is left to cbAlloc.
+		static constexpr unsigned s_minObjSizeLog2 = 5;
+		static constexpr unsigned s_numClasses = 6;
+		static constexpr size_t s_maxObjSize = size_t(1) << (s_minObjSizeLog2 + s_numClasses - 1);
+		static constexpr size_t s_maxObjAlign = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+		// Backing memory is obtained from cbAlloc in regions, which are carved into
+		// pages. Each page only ever holds objects belonging to a single size class.
+		static constexpr size_t s_pageSize = 0x4000;
+		static constexpr unsigned s_pagesPerRegion = 16;
+		static constexpr size_t s_regionSize = s_pageSize * s_pagesPerRegion;
+		static constexpr unsigned s_maxRegions = 32;
+
+		// Maximum number of free objects (per size class) kept in each thread's cache
+		static constexpr unsigned s_cacheSize = 16;
+
+	private:
+		struct FreeObj
+		{
+			FreeObj* m_next;
+		};
+
+		struct SizeClass
+		{
+			FreeObj* m_freeList;
+			uint32_t m_numPages;
+			uint32_t m_numFree;
+		};
+
+		// Objects cached by a thread are bound to a single allocator at a time. The
+		// cache is drained back into its owner when the thread switches to another
+		// allocator, and when the thread exits. Caches are kept in a global list so
+		// that statistics can tell cached objects apart from those actually in use.
+		struct ThreadCache
+		{
+			SlabAllocator* m_owner;
+			uint32_t m_serial;
+			uint32_t m_count[s_numClasses];
+			FreeObj* m_head[s_numClasses];
+			ThreadCache* m_next;
+			ThreadCache* m_prev;
+			bool m_linked;
+
+			constexpr ThreadCache() noexcept :
+				m_owner{}, m_serial{}, m_count{}, m_head{}, m_next{}, m_prev{}, m_linked{} { }
+			~ThreadCache();
+
+			void bind(SlabAllocator* owner) noexcept;
+			void drain() noexcept; // must be called with s_listMutex held
+		};
+
+		static thread_local ThreadCache s_threadCache;
+
+		// Guards the lists of live allocators and thread caches. When both are
+		// needed, this is taken before the mutex of an allocator.
+		static Mutex s_listMutex;
+		static SlabAllocator* s_liveList;
+		static ThreadCache* s_cacheList;
+
+		Mutex m_mutex;
+		SlabAllocator* m_nextLive; // global list of live allocators
+		uint32_t m_serial;
+		uint32_t m_numRegions;
+		uint32_t m_nextPage;
+		uintptr_t m_regions[s_maxRegions];
+		uint8_t m_pageClass[s_maxRegions][s_pagesPerRegion];
+		SizeClass m_classes[s_numClasses];
+
+		static constexpr unsigned sizeToClass(size_t size) noexcept
+		{
+			if (size <= (size_t(1) << s_minObjSizeLog2))
+				return 0;
+			return 32 - __builtin_clz(uint32_t(size - 1)) - s_minObjSizeLog2;
+		}
+
+		static constexpr size_t classToSize(unsigned cls) noexcept
+		{
+			return size_t(1) << (s_minObjSizeLog2 + cls);
+		}
+
+		int lookupClass(const void* ptr) const noexcept;
+		bool addPage(unsigned cls) noexcept;
+		uint32_t popObjects(unsigned cls, FreeObj*& out, uint32_t count) noexcept;
+		void pushObjects(unsigned cls, FreeObj* first, FreeObj* last, uint32_t count) noexcept;
+
+		ThreadCache* getThreadCache() noexcept
+		{
+			ThreadCache* tc = &s_threadCache;
+			if (tc->m_owner != this || tc->m_serial != m_serial)
+				tc->bind(this);
+			return tc;
+		}
+
+	public:
+		constexpr SlabAllocator(DkDevice device) noexcept : ObjBase{device},
+			m_mutex{}, m_nextLive{}, m_serial{}, m_numRegions{}, m_nextPage{},
+			m_regions{}, m_pageClass{}, m_classes{} { }
+
+		static constexpr bool isSuitable(size_t size, size_t alignment) noexcept
+		{
+			return size && size <= s_maxObjSize && alignment <= s_maxObjAlign;
+		}
+
+		void initialize() noexcept;
+		void cleanup() noexcept;
+
+		void* allocObj(size_t size) noexcept;
+		bool freeObj(void* ptr) noexcept;
+
+		void getStats(DkSlabStats& out) noexcept;
+	};
+}
@@ -0,0 +1,141 @@
+#include "swizzle.h"
+
+using namespace dk::detail;
+
+namespace
+{
+	// A GOB is 64 bytes wide and 8 rows tall (512 bytes). Inside it, every row is
+	// split into four 16-byte sectors, which are interleaved with the sectors of
+	// the neighbouring rows as follows:
+	//   bit 8: x bit 5, bits 6-7: y bits 1-2, bit 5: x bit 4, bit 4: y bit 0, bits 0-3: x bits 0-3
+	constexpr uint32_t gobOffset(uint32_t x, uint32_t y)
+	{
+		return ((x & 0x20) << 3) | ((y & 6) << 5) | ((x & 0x10) << 1) | ((y & 1) << 4) | (x & 0xf);
+	}
+
+	// A fixed size copy already compiles down to a single 128-bit load/store pair
+	inline void copySector(uint8_t* dst, const uint8_t* src)
+	{
+		memcpy(dst, src, 16);
+	}
+
+	template <bool ToTiled>
+	inline void move(uint8_t* gob, uint8_t* linear, uint32_t size)
+	{
+		if constexpr (ToTiled)
+			memcpy(gob, linear, size);
+		else
+			memcpy(linear, gob, size);
+	}
+
+	template <bool ToTiled>
+	inline void moveSector(uint8_t* gob, uint8_t* linear)
+	{
+		if constexpr (ToTiled)
+			copySector(gob, linear);
+		else
+			copySector(linear, gob);
+	}
+
+	// Transfers an entire GOB, four sectors per row
+	template <bool ToTiled>
+	void moveFullGob(uint8_t* gob, uint8_t* linear, uint32_t rowPitch)
+	{
+		for (uint32_t y = 0; y < 8; y ++, linear += rowPitch)
+		{
+			uint8_t* row = gob + gobOffset(0, y);
+			moveSector<ToTiled>(row,       linear);
+			moveSector<ToTiled>(row + 32,  linear + 16);
+			moveSector<ToTiled>(row + 256, linear + 32);
+			moveSector<ToTiled>(row + 288, linear + 48);
+		}
+	}
+
+	// Transfers the bytes [x0,x1) of rows [y0,y1) of a GOB, one sector piece at a time
+	template <bool ToTiled>
+	void movePartialGob(uint8_t* gob, uint8_t* linear, uint32_t rowPitch, uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1)
+	{
+		for (uint32_t y = y0; y < y1; y ++, linear += rowPitch)
+		{
+			uint8_t* src = linear;
+			for (uint32_t x = x0; x < x1;)
+			{
+				uint32_t end = (x | 0xf) + 1;
+				if (end > x1) end = x1;
+				move<ToTiled>(gob + gobOffset(x, y), src, end - x);
+				src += end - x;
+				x = end;
+			}
+		}
+	}
+
+	// Offset of the GOB holding byte x of row y of slice z within the level
+	uint64_t gobAddress(TiledLevel const& level, uint32_t x, uint32_t y, uint32_t z)
+	{
+		const uint32_t gobX = x >> 6, gobY = y >> 3;
+		const uint32_t tileY = gobY >> level.m_tileHShift, tileZ = z >> level.m_tileDShift;
+		const uint32_t innerY = gobY & ((1U << level.m_tileHShift) - 1);
+		const uint32_t innerZ = z & ((1U << level.m_tileDShift) - 1);
+		return (uint64_t((tileZ * level.m_heightTiles + tileY) * level.m_widthTiles + gobX) << level.tileShift())
+			+ (innerZ << (9 + level.m_tileHShift)) + (innerY << 9);
+	}
+
+	template <bool ToTiled>
+	void swizzle(uint8_t* tiled, TiledLevel const& level, uint8_t* linear, SwizzleRect const& rect)
+	{
+		const unsigned tileShift = level.tileShift();
+		const uint32_t tileHMask = (1U << level.m_tileHShift) - 1;
+		const uint32_t tileDMask = (1U << level.m_tileDShift) - 1;
+		const uint32_t xEnd = rect.x + rect.widthBytes;
+		const uint32_t yEnd = rect.y + rect.height;
+
+		for (uint32_t z = 0; z < rect.depth; z ++)
+		{
+			uint32_t sliceZ = rect.z + z;
+			uint8_t* slice = tiled
+				+ (uint64_t((sliceZ >> level.m_tileDShift) * level.m_heightTiles * level.m_widthTiles) << tileShift)
+				+ ((sliceZ & tileDMask) << (9 + level.m_tileHShift));
+			uint8_t* sliceLinear = linear + uint64_t(z) * rect.slicePitch;
+
+			for (uint32_t gobY = rect.y >> 3; gobY <= (yEnd - 1) >> 3; gobY ++)
+			{
+				uint8_t* gobRow = slice
+					+ (uint64_t((gobY >> level.m_tileHShift) * level.m_widthTiles) << tileShift)
+					+ ((gobY & tileHMask) << 9);
+				uint32_t y0 = gobY*8 > rect.y ? gobY*8 : rect.y;
+				uint32_t y1 = gobY*8 + 8 < yEnd ? gobY*8 + 8 : yEnd;
+				uint8_t* rowLinear = sliceLinear + (y0 - rect.y) * rect.rowPitch;
+
+				for (uint32_t gobX = rect.x >> 6; gobX <= (xEnd - 1) >> 6; gobX ++)
+				{
+					uint8_t* gob = gobRow + (uint64_t(gobX) << tileShift);
+					uint32_t x0 = gobX*64 > rect.x ? gobX*64 : rect.x;
+					uint32_t x1 = gobX*64 + 64 < xEnd ? gobX*64 + 64 : xEnd;
+					uint8_t* src = rowLinear + (x0 - rect.x);
+
+					if (x1 - x0 == 64 && y1 - y0 == 8)
+						moveFullGob<ToTiled>(gob, src, rect.rowPitch);
+					else
+						movePartialGob<ToTiled>(gob, src, rect.rowPitch, x0 & 63, ((x1 - 1) & 63) + 1, y0 & 7, ((y1 - 1) & 7) + 1);
+				}
+			}
+		}
+	}
+}
+
+void dk::detail::CalcBlockLinearRange(TiledLevel const& level, SwizzleRect const& rect, uint64_t& offset, uint64_t& size)
+{
+	// Addresses grow with the GOB coordinates, so the first and last GOBs bound the range
+	offset = gobAddress(level, rect.x, rect.y, rect.z);
+	size = gobAddress(level, rect.x + rect.widthBytes - 1, rect.y + rect.height - 1, rect.z + rect.depth - 1) + 512 - offset;
+}
+
+void dk::detail::SwizzleToBlockLinear(void* tiled, TiledLevel const& level, const void* linear, SwizzleRect const& rect)
+{
+	swizzle<true>(static_cast<uint8_t*>(tiled), level, static_cast<uint8_t*>(const_cast<void*>(linear)), rect);
+}
+
+void dk::detail::DeswizzleFromBlockLinear(void* linear, TiledLevel const& level, const void* tiled, SwizzleRect const& rect)
+{
+	swizzle<false>(static_cast<uint8_t*>(const_cast<void*>(tiled)), level, static_cast<uint8_t*>(linear), rect);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "dk_private.h"
+
+namespace dk::detail
+{
+	// Block linear geometry of a single mip level. Tiles (blocks) are always one
+	// GOB wide, and contain (1<<m_tileHShift) GOBs vertically and (1<<m_tileDShift)
+	// slices of those in depth.
+	struct TiledLevel
+	{
+		uint32_t m_widthBytes;
+		uint32_t m_height;
+		uint32_t m_depth;
+		uint32_t m_widthTiles;
+		uint32_t m_heightTiles;
+		uint32_t m_depthTiles;
+		uint8_t m_tileHShift;
+		uint8_t m_tileDShift;
+
+		constexpr unsigned tileShift() const noexcept { return 9 + m_tileHShift + m_tileDShift; }
+		constexpr uint64_t size() const noexcept
+		{
+			return uint64_t(m_widthTiles*m_heightTiles*m_depthTiles) << tileShift();
+		}
+	};
+
+	// Region of a level to transfer. X coordinates and widths are expressed in bytes,
+	// the pitches describe the layout of the linear side of the transfer.
+	struct SwizzleRect
+	{
+		uint32_t x, y, z;
+		uint32_t widthBytes, height, depth;
+		uint32_t rowPitch;
+		uint32_t slicePitch;
+	};
+
+	// Works out the smallest contiguous range of bytes within the level (relative to its
+	// start) holding every GOB that a transfer of rect touches
+	void CalcBlockLinearRange(TiledLevel const& level, SwizzleRect const& rect, uint64_t& offset, uint64_t& size);
+
+	void SwizzleToBlockLinear(void* tiled, TiledLevel const& level, const void* linear, SwizzleRect const& rect);
+	void DeswizzleFromBlockLinear(void* linear, TiledLevel const& level, const void* tiled, SwizzleRect const& rect);
+}